@@ -12,19 +12,42 @@
 #include "sequence.h"
 #include "alignment.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(alignment) {
 	std::string name = pairalign_init(argc > 1 ? argv[1] : "input/alignment/prot.20.aa");
 	align_seq_init();
 	align_seq();
 
-	inncabs::run_all(
-		[](const std::launch l) {
-			return pairalign(l);
-		},
-		[](int result) {
-			return align_verify(); 
-		},
-		name,
-		[]() { align_init(); }
-		);
+	if(inncabs::service::requested()) {
+		// request k aligns the k-th pair of non-empty sequences, in the order of the sequential alignment
+		std::vector<std::pair<int, int>> pairs;
+		for(int si = 0; si < nseqs; si++) {
+			for(int sj = si + 1; sj < nseqs; sj++) {
+				if(seqlen_array[si+1] != 0 && seqlen_array[sj+1] != 0) pairs.push_back(std::make_pair(si, sj));
+			}
+		}
+		if(pairs.empty()) inncabs::error("Error: no pairs of sequences to align\n");
+		inncabs::serve(
+			[pairs](const std::launch l, unsigned long long k) {
+				const std::pair<int, int>& p = pairs[k % pairs.size()];
+				return pairalign_pair(p.first, p.second);
+			},
+			[pairs](unsigned long long k, int score) {
+				const std::pair<int, int>& p = pairs[k % pairs.size()];
+				return score == seq_output[p.first*nseqs+p.second];
+			},
+			name
+			);
+	}
+	else {
+		inncabs::run_all(
+			[](const std::launch l) {
+				return pairalign(l);
+			},
+			[](int result) {
+				return align_verify(); 
+			},
+			name,
+			[]() { align_init(); }
+			);
+	}
 }
@@ -13,6 +13,7 @@ void init_matrix(void);
 std::string pairalign_init(const char *filename);
 int pairalign();
 int pairalign_seq();
+int pairalign_pair(int si, int sj);
 void align_init();
 void align();
 void align_seq_init();
@@ -384,8 +385,8 @@ double tracepath(int tsb1, int tsb2, int *print_ptr, int *displ, int seq1, int s
 }
 
 int pairalign(const std::launch l) {
-	int i, n, m, si, sj;
-	int len1, maxres;
+	int si, sj;
+	int maxres;
 	int    *mat_xref, *matptr;
 
 	matptr   = gon250mt;
@@ -395,53 +396,16 @@ int pairalign(const std::launch l) {
 
 	inncabs::message("Start aligning ");
 
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 	for (si = 0; si < nseqs; si++) {
-		n = seqlen_array[si+1];
-		for (i = 1, len1 = 0; i <= n; i++) {
-			char c = seq_array[si+1][i];
-			if ((c != gap_pos1) && (c != gap_pos2)) len1++;
-		}
 		for (sj = si + 1; sj < nseqs; sj++)
 		{
-			m = seqlen_array[sj+1];
-			if ( n == 0 || m == 0 ) {
+			if ( seqlen_array[si+1] == 0 || seqlen_array[sj+1] == 0 ) {
 				bench_output[si*nseqs+sj] = (int) 1.0;
 			} else {
-				futures.push_back( std::async(l, [&,i,m,n,si,sj,len1]() mutable {
-					int se1, se2, sb1, sb2, maxscore, seq1, seq2, g, gh, len2;
-					int displ[2*MAX_ALN_LENGTH+1];
-					int print_ptr, last_print;
-
-					for (i = 1, len2 = 0; i <= m; i++) {
-						char c = seq_array[sj+1][i];
-						if ((c != gap_pos1) && (c != gap_pos2)) len2++;
-					}
-					if ( dnaFlag ) {
-						g  = (int) ( 2 * INT_SCALE * pw_go_penalty * gap_open_scale ); // gapOpen
-						gh = (int) (INT_SCALE * pw_ge_penalty * gap_extend_scale); //gapExtend
-					} else {
-						double gg = pw_go_penalty + log((double) MIN(n, m)); // temporary value
-						g  = (int) ((mat_avscore <= 0) ? (2 * INT_SCALE * gg) : (2 * mat_avscore * gg * gap_open_scale) ); // gapOpen
-						gh = (int) (INT_SCALE * pw_ge_penalty); //gapExtend
-					}
-
-					seq1 = si + 1;
-					seq2 = sj + 1;
-
-					forward_pass(&seq_array[seq1][0], &seq_array[seq2][0], n, m, &se1, &se2, &maxscore, g, gh);
-					reverse_pass(&seq_array[seq1][0], &seq_array[seq2][0], se1, se2, &sb1, &sb2, maxscore, g, gh);
-
-					print_ptr  = 1;
-					last_print = 0;
-
-					diff(sb1-1, sb2-1, se1-sb1+1, se2-sb2+1, 0, 0, &print_ptr, &last_print, displ, seq1, seq2, g, gh);
-					double mm_score = tracepath(sb1, sb2, &print_ptr, displ, seq1, seq2);
-
-					if (len1 == 0 || len2 == 0) mm_score  = 0.0;
-					else                        mm_score /= (double) MIN(len1,len2);
-
-					bench_output[si*nseqs+sj] = (int) mm_score;
+				// the same scoring as a request of the service mode
+				futures.push_back( inncabs::async(l, [si,sj]() {
+					bench_output[si*nseqs+sj] = pairalign_pair(si, sj);
 				} ) ); // end async
 			} // end if (n == 0 || m == 0)
 		} // for (j)
@@ -517,6 +481,51 @@ int pairalign_seq() {
 	return 0;
 }
 
+// score of a single pair of non-empty sequences, get_matrix must have been called before
+int pairalign_pair(int si, int sj) {
+	int i, n, m, len1, len2;
+	int se1, se2, sb1, sb2, maxscore, seq1, seq2, g, gh;
+	int displ[2*MAX_ALN_LENGTH+1];
+	int print_ptr, last_print;
+	double gg, mm_score;
+
+	n = seqlen_array[si+1];
+	m = seqlen_array[sj+1];
+	for (i = 1, len1 = 0; i <= n; i++) {
+		char c = seq_array[si+1][i];
+		if ((c != gap_pos1) && (c != gap_pos2)) len1++;
+	}
+	for (i = 1, len2 = 0; i <= m; i++) {
+		char c = seq_array[sj+1][i];
+		if ((c != gap_pos1) && (c != gap_pos2)) len2++;
+	}
+
+	if ( dnaFlag ) {
+		g  = (int) ( 2 * INT_SCALE * pw_go_penalty * gap_open_scale ); // gapOpen
+		gh = (int) (INT_SCALE * pw_ge_penalty * gap_extend_scale); //gapExtend
+	} else {
+		gg = pw_go_penalty + log((double) MIN(n, m)); // temporary value
+		g  = (int) ((mat_avscore <= 0) ? (2 * INT_SCALE * gg) : (2 * mat_avscore * gg * gap_open_scale) ); // gapOpen
+		gh = (int) (INT_SCALE * pw_ge_penalty); //gapExtend
+	}
+	seq1 = si + 1;
+	seq2 = sj + 1;
+
+	forward_pass(&seq_array[seq1][0], &seq_array[seq2][0], n, m, &se1, &se2, &maxscore, g, gh);
+	reverse_pass(&seq_array[seq1][0], &seq_array[seq2][0], se1, se2, &sb1, &sb2, maxscore, g, gh);
+
+	print_ptr  = 1;
+	last_print = 0;
+
+	diff(sb1-1, sb2-1, se1-sb1+1, se2-sb2+1, 0, 0, &print_ptr, &last_print, displ, seq1, seq2, g, gh);
+	mm_score = tracepath(sb1, sb2, &print_ptr, displ, seq1, seq2);
+
+	if (len1 == 0 || len2 == 0) mm_score  = 0.0;
+	else                        mm_score /= (double) MIN(len1,len2);
+
+	return (int) mm_score;
+}
+
 void init_matrix(void) {
 	int  i, j;
 	char c1, c2;
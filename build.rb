@@ -1,7 +1,8 @@
 require 'color.rb'
 
-COMPILER = "/software-local/insieme-libs/llvm-latest/bin/clang++"
-CPPFLAGS = "-std=c++11 -stdlib=libc++ -Wall -isystem /software-local/insieme-libs/libc++-svn/include/c++/v1/ -L /software-local/insieme-libs/libc++-svn/lib/"
+# CXX and CXXFLAGS override the default compiler settings, see CMakeLists.txt for a portable build
+COMPILER = ENV["CXX"] || "/software-local/insieme-libs/llvm-latest/bin/clang++"
+CPPFLAGS = ENV["CXXFLAGS"] || "-std=c++11 -stdlib=libc++ -Wall -isystem /software-local/insieme-libs/libc++-svn/include/c++/v1/ -L /software-local/insieme-libs/libc++-svn/lib/"
 
 debug = ARGV.include?("--dbg")
 parallel = ARGV.include?("--par")
@@ -10,7 +11,9 @@ ARGV.delete_if { |e| e.start_with?("--") }
 
 threads = []
 
-Dir["**/*.cpp"].each do |cppfile|
+benchmarks = Dir["**/*.cpp"].reject { |cppfile| cppfile.start_with?("driver/") }
+
+benchmarks.each do |cppfile|
 	next if !ARGV.empty? && !ARGV.any? { |arg| cppfile =~ /#{arg}/ }
 	job = lambda do
 		fname = File.basename(cppfile, ".cpp")
@@ -33,3 +36,22 @@ end
 
 threads.each { |t| t.join }
 
+# the driver links all benchmarks into one binary, each compiled as a separate object with INNCABS_DRIVER
+if(ARGV.empty? || ARGV.include?("driver")) then
+	objects = benchmarks.map { |cppfile| "bin/obj/" + File.basename(cppfile, ".cpp") + ".o" }
+	if(clean) then
+		(objects + ["bin/inncabs"]).each { |f| File.delete(f) if File.exists?(f) }
+		puts "======== Cleaned " + "inncabs driver".red.bold
+	else
+		Dir.mkdir("bin/obj") unless File.directory?("bin/obj")
+		flags = CPPFLAGS + (debug && " -g3" || " -O3")
+		puts "======== Building " + "inncabs driver".green.bold + (debug && " debug" || " release") + " version"
+		jobs = benchmarks.zip(objects).map do |cppfile, objfile|
+			job = lambda { `#{COMPILER} -c #{cppfile} -o #{objfile} -DINNCABS_DRIVER #{flags}` }
+			parallel && Thread.new { job.call } || job.call
+		end
+		jobs.each { |t| t.join if t.is_a?(Thread) }
+		`#{COMPILER} driver/inncabs.cpp #{objects.join(" ")} -o bin/inncabs #{flags}`
+	end
+end
+
@@ -0,0 +1,37 @@
+# Runs the benchmarks built with INNCABS_PGO=GENERATE to collect their profiles
+#
+# Invoked by the pgo-train target with:
+#   BIN_DIR        folder containing the benchmark binaries
+#   PGO_DIR        folder the profiles are written to
+#   RUNS           comma-separated list of <benchmark>|<arguments>
+#   LAUNCH_TYPES   launch types to train with
+#   LLVM_PROFDATA  llvm-profdata for merging the raw Clang profiles, empty for GCC
+
+cmake_policy(SET CMP0007 NEW)
+
+set(ENV{INNCABS_LAUNCH_TYPES} ${LAUNCH_TYPES})
+set(ENV{INNCABS_REPEATS} "1")
+set(ENV{INNCABS_MIN_OUTPUT} "true")
+
+file(MAKE_DIRECTORY ${PGO_DIR})
+string(REPLACE "," ";" runs "${RUNS}")
+foreach(run ${runs})
+	string(REPLACE "|" ";" run "${run}")
+	list(GET run 0 name)
+	list(GET run 1 arg_string)
+	separate_arguments(args UNIX_COMMAND "${arg_string}")
+	message(STATUS "Training ${name} ${arg_string}")
+	execute_process(COMMAND ${BIN_DIR}/${name} ${args} RESULT_VARIABLE result OUTPUT_QUIET)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "Training run of ${name} failed: ${result}")
+	endif()
+endforeach()
+
+if(LLVM_PROFDATA)
+	file(GLOB raw_profiles ${PGO_DIR}/*.profraw)
+	execute_process(COMMAND ${LLVM_PROFDATA} merge -output=${PGO_DIR}/default.profdata ${raw_profiles} RESULT_VARIABLE result)
+	if(NOT result EQUAL 0)
+		message(FATAL_ERROR "Merging the profiles failed: ${result}")
+	endif()
+	file(REMOVE ${raw_profiles})
+endif()
@@ -0,0 +1,188 @@
+require 'json'
+require './color.rb'
+
+# Compares two sets of results and fails if the candidate is significantly slower than the baseline
+#
+# Usage: ruby compare.rb <baseline> <candidate> [--threshold <percent>] [--alpha <level>]
+#
+# Result sets are either JSON files (results.json written by run.rb, or the INNCABS_JSON_OUTPUT of a
+# single benchmark) or CSV files (INNCABS_CSV_OUTPUT of one or more benchmarks). Measurements are
+# matched by benchmark, launch type and thread count. A slowdown is a regression if the median time
+# grew by more than the threshold (default: 5%) and, where the individual repetitions are available,
+# a two-sided Mann-Whitney U test rejects equal distributions at the given level (default: 0.05).
+# CSV files only contain the median, so there the threshold alone decides. Results of the service
+# mode measure latencies instead of run times and are skipped.
+#
+# The exit code is 1 if any measurement regressed or failed its verification, 0 otherwise.
+
+def read_float_param(name, default)
+	param = default
+	if(ARGV.include?(name))
+		idx = ARGV.index(name)
+		param = ARGV[idx+1].to_f
+		ARGV.delete_at(idx)
+		ARGV.delete_at(idx)
+	end
+	return param
+end
+
+threshold = read_float_param("--threshold", 5.0)
+alpha = read_float_param("--alpha", 0.05)
+
+if(ARGV.size != 2)
+	puts "Usage: ruby compare.rb <baseline> <candidate> [--threshold <percent>] [--alpha <level>]"
+	exit 2
+end
+
+# measurement = { :times => [ms, ...] or nil, :median => ms, :success => bool }, keyed by [benchmark, launch, threads]
+def read_json(content)
+	measurements = {}
+	runs = JSON.parse(content)
+	runs = [runs] unless runs.is_a?(Array)
+	runs.each do |run|
+		if(run["mode"] == "service")
+			$stderr.puts "skipping service mode results of #{run["benchmark"].strip}"
+			next
+		end
+		run["results"].each do |res|
+			threads = res["threads"] || run["num_cpus"]
+			measurements[[run["benchmark"].strip, res["launch"], threads]] = {
+				:times => res["times_ms"], :median => res["summary"]["median_ms"], :success => res["success"] }
+		end
+	end
+	return measurements
+end
+
+# header lines end in the fixed column names, the description before them may itself contain commas,
+# e.g. "Sort with N = 20000, cutoffs = 512 / 512 / 128, threads, success, time (ms), ..."
+CSV_HEADER = /^(.*?), (threads, success|success), time \(ms\)/
+CSV_SERVICE_HEADER = /^(.*?), threads, success, offered \(1\/s\)/
+
+def read_csv(content)
+	measurements = {}
+	bench = nil
+	has_threads = false
+	content.each_line do |line|
+		if(header = CSV_SERVICE_HEADER.match(line))
+			# header line of a benchmark in service mode, its rows hold rates and latencies
+			$stderr.puts "skipping service mode results of #{header[1].strip}"
+			bench = nil
+			next
+		end
+		if(header = CSV_HEADER.match(line))
+			# header line of one benchmark
+			bench = header[1].strip
+			has_threads = header[2].start_with?("threads")
+			next
+		end
+		fields = line.split(",").map { |f| f.strip }
+		next if fields.empty? || fields[0].empty?
+		next unless bench
+		threads = has_threads ? fields[1].to_i : nil
+		values = has_threads ? fields[2..-1] : fields[1..-1]
+		measurements[[bench, fields[0], threads]] = { :times => nil, :median => values[1].to_f, :success => values[0] == "1" }
+	end
+	return measurements
+end
+
+def read_results(file)
+	content = IO.read(file)
+	return content.lstrip.start_with?("{", "[") ? read_json(content) : read_csv(content)
+end
+
+def median(values)
+	sorted = values.sort
+	n = sorted.size
+	return n.odd? ? sorted[n/2] : (sorted[n/2-1] + sorted[n/2]) / 2.0
+end
+
+def normal_cdf(z)
+	return 0.5 * Math.erfc(-z / Math.sqrt(2))
+end
+
+# two-sided p-value of the Mann-Whitney U test
+# exact for small samples without ties, normal approximation with tie correction otherwise
+def mann_whitney(a, b)
+	n1, n2 = a.size, b.size
+	all = (a.map { |v| [v, 0] } + b.map { |v| [v, 1] }).sort_by { |v| v[0] }
+	ranks = Array.new(all.size)
+	tie_term = 0.0
+	i = 0
+	while(i < all.size)
+		j = i
+		j += 1 while(j + 1 < all.size && all[j + 1][0] == all[i][0])
+		(i..j).each { |k| ranks[k] = (i + j) / 2.0 + 1 }
+		t = j - i + 1
+		tie_term += t**3 - t
+		i = j + 1
+	end
+	r1 = 0.0
+	all.each_with_index { |v, k| r1 += ranks[k] if v[1] == 0 }
+	u = r1 - n1 * (n1 + 1) / 2.0
+	u = [u, n1 * n2 - u].min
+	if(tie_term == 0 && n1 + n2 <= 40)
+		# counts[k] = number of arrangements with U = k, built up one element at a time
+		counts = Array.new(n1 + 1) { |x| Array.new(n2 + 1) { |y| nil } }
+		count = lambda do |x, y|
+			return counts[x][y] if counts[x][y]
+			if(x == 0 || y == 0)
+				counts[x][y] = [1]
+			else
+				with_a = count.call(x - 1, y).each_with_index.map { |c, k| [k + y, c] }
+				with_b = count.call(x, y - 1).each_with_index.map { |c, k| [k, c] }
+				dist = Array.new(x * y + 1, 0)
+				(with_a + with_b).each { |k, c| dist[k] += c }
+				counts[x][y] = dist
+			end
+			counts[x][y]
+		end
+		dist = count.call(n1, n2)
+		total = dist.inject(:+).to_f
+		tail = dist[0..u.floor].inject(:+) / total
+		return [2 * tail, 1.0].min
+	end
+	n = n1 + n2
+	sigma = Math.sqrt(n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1))))
+	return 1.0 if sigma == 0
+	z = (u - n1 * n2 / 2.0 + 0.5) / sigma
+	return [2 * normal_cdf(z), 1.0].min
+end
+
+baseline = read_results(ARGV[0])
+candidate = read_results(ARGV[1])
+
+regressions = 0
+puts "benchmark".ljust(48) + "launch".rjust(10) + "threads".rjust(8) + "base (ms)".rjust(14) + "cand (ms)".rjust(14) + "speedup".rjust(10) + "p".rjust(10) + "  status"
+(baseline.keys | candidate.keys).sort_by { |k| k.map { |e| e.to_s } }.each do |key|
+	bench, launch, threads = key
+	base = baseline[key]
+	cand = candidate[key]
+	line = bench[0, 47].ljust(48) + launch.rjust(10) + threads.to_s.rjust(8)
+	if(!base || !cand)
+		puts line + "  " + (base ? "missing in candidate" : "missing in baseline").brown
+		next
+	end
+	speedup = base[:median] / cand[:median]
+	slowdown = (cand[:median] / base[:median] - 1) * 100
+	p_value = nil
+	p_value = mann_whitney(base[:times], cand[:times]) if base[:times] && cand[:times] && base[:times].size > 1 && cand[:times].size > 1
+	line += ("%.3f" % base[:median]).rjust(14) + ("%.3f" % cand[:median]).rjust(14) + ("%.3f" % speedup).rjust(10)
+	line += (p_value ? ("%.4f" % p_value) : "n/a").rjust(10)
+	if(!cand[:success])
+		regressions += 1
+		puts line + "  " + "FAILED".red.bold
+	elsif(slowdown > threshold && (!p_value || p_value < alpha))
+		regressions += 1
+		puts line + "  " + ("%.1f%% slower" % slowdown).red.bold
+	elsif(slowdown < -threshold && (!p_value || p_value < alpha))
+		puts line + "  " + ("%.1f%% faster" % -slowdown).green
+	else
+		puts line + "  ok"
+	end
+end
+
+if(regressions > 0)
+	puts "#{regressions} regression(s) beyond #{threshold}% (alpha #{alpha})".red.bold
+	exit 1
+end
+puts "no regressions beyond #{threshold}% (alpha #{alpha})".green.bold
@@ -0,0 +1,214 @@
+#include "../include/inncabs.h"
+
+#include <limits>
+
+/*
+ * Runs any number of benchmarks in a single process
+ *
+ * Usage: inncabs <benchmark> [arguments...] [-- <benchmark> [arguments...]]...
+ *        inncabs --mix <benchmark> [arguments...] [-- <benchmark> [arguments...]]...
+ *        inncabs --list
+ *
+ * Every benchmark is linked in from its own translation unit compiled with INNCABS_DRIVER, where
+ * INNCABS_MAIN registers its entry point instead of defining main. The benchmarks are run in the
+ * given order with the usual INNCABS_* settings, and share the thread pools of the executors, so that
+ * only the first benchmark pays for starting them. With INNCABS_JSON_OUTPUT, the documents of all
+ * benchmarks are printed as one JSON array.
+ *
+ * With --mix, every benchmark is first run alone and then all of them concurrently, as tenants of
+ * the same executors (see mix.h). For every launch configuration, the slowdown of each benchmark in
+ * the mix relative to its solo run is reported, together with the system throughput (the sum of the
+ * progress rates solo/mix of all tenants), the mean slowdown and the fairness (the lowest progress
+ * rate divided by the highest one).
+ */
+
+namespace {
+	using invocation = std::vector<char*>;
+
+	struct tenant {
+		invocation args;
+		std::string description;
+		std::vector<inncabs::ConfigResult> solo;
+		std::vector<inncabs::ConfigResult> mixed;
+	};
+
+	void run(const invocation& inv) {
+		std::vector<char*> args = inv;
+		int argc = static_cast<int>(args.size());
+		args.push_back(nullptr);
+		inncabs::registry().at(args[0])(argc, args.data());
+	}
+
+	const inncabs::ConfigResult* find_result(const std::vector<inncabs::ConfigResult>& results, const inncabs::ConfigResult& config) {
+		for(const auto& res : results) {
+			if(res.launch == config.launch && res.threads == config.threads) return &res;
+		}
+		return nullptr;
+	}
+
+	void run_mix(std::vector<tenant>& tenants, bool json) {
+		std::mutex sinkMutex;
+
+		// solo runs, one after another
+		for(auto& t : tenants) {
+			inncabs::current_sink() = [&t](const std::string& bench, const std::vector<inncabs::ConfigResult>& results) {
+				t.description = bench;
+				t.solo = results;
+			};
+			run(t.args);
+		}
+
+		// concurrent runs, each tenant on its own thread, tracing is configured once before they start
+		inncabs::tracing::configure();
+		inncabs::current_sink() = [&tenants, &sinkMutex](const std::string& bench, const std::vector<inncabs::ConfigResult>& results) {
+			std::lock_guard<std::mutex> lock(sinkMutex);
+			for(auto& t : tenants) {
+				if(t.description == bench) t.mixed = results;
+			}
+		};
+		inncabs::mix::begin(static_cast<unsigned>(tenants.size()));
+		std::vector<std::thread> threads;
+		for(const auto& t : tenants) threads.emplace_back(run, t.args);
+		for(auto& t : threads) t.join();
+		inncabs::mix::end();
+		inncabs::current_sink() = inncabs::result_sink();
+
+		std::unique_ptr<inncabs::json::writer> w;
+		if(json) {
+			w.reset(new inncabs::json::writer(std::cout));
+			w->begin_object();
+			w->key("mix").begin_array();
+			for(const auto& t : tenants) w->value(t.description);
+			w->end_array();
+			w->field("arguments", inncabs::command_line());
+			w->key("results").begin_array();
+		}
+		else {
+			std::cout << "Mix of";
+			for(const auto& t : tenants) std::cout << " " << t.args[0];
+			std::cout << std::endl;
+		}
+
+		for(const auto& config : tenants.front().solo) {
+			double stp = 0, antt = 0, minProgress = std::numeric_limits<double>::max(), maxProgress = 0;
+			bool complete = true;
+			for(const auto& t : tenants) {
+				const inncabs::ConfigResult* solo = find_result(t.solo, config);
+				const inncabs::ConfigResult* mixed = find_result(t.mixed, config);
+				if(!solo || !mixed || solo->times.empty() || mixed->times.empty()) {
+					complete = false;
+					break;
+				}
+				const double progress = solo->summary.p50 / mixed->summary.p50;
+				stp += progress;
+				antt += 1.0 / progress;
+				minProgress = std::min(minProgress, progress);
+				maxProgress = std::max(maxProgress, progress);
+			}
+			if(!complete) continue;
+			antt /= tenants.size();
+			const double fairness = minProgress / maxProgress;
+
+			if(json) {
+				w->begin_object();
+				w->field("launch", config.launch);
+				w->field("threads", config.threads);
+				w->field("system_throughput", stp);
+				w->field("mean_slowdown", antt);
+				w->field("fairness", fairness);
+				w->key("workloads").begin_array();
+			}
+			else {
+				std::cout << std::endl << config.launch << ", " << config.threads << " threads:" << std::endl;
+			}
+			for(const auto& t : tenants) {
+				const inncabs::ConfigResult* solo = find_result(t.solo, config);
+				const inncabs::ConfigResult* mixed = find_result(t.mixed, config);
+				const double slowdown = mixed->summary.p50 / solo->summary.p50;
+				const bool success = solo->success() && mixed->success();
+				if(json) {
+					w->begin_object();
+					w->field("benchmark", t.description);
+					w->field("success", success);
+					w->field("solo_median_ms", solo->summary.p50);
+					w->field("mix_median_ms", mixed->summary.p50);
+					w->field("mix_p99_ms", mixed->summary.p99);
+					w->field("slowdown", slowdown);
+					w->field("solo_times_ms", solo->times);
+					w->field("mix_times_ms", mixed->times);
+					w->end_object();
+				}
+				else {
+					std::cout << std::setw(12) << t.args[0] << ": " << (success ? "success" : "failure")
+						<< ", solo " << std::setw(10) << solo->summary.p50 << " ms"
+						<< ", mix " << std::setw(10) << mixed->summary.p50 << " ms"
+						<< ", slowdown " << std::setprecision(3) << slowdown << std::setprecision(6) << std::endl;
+				}
+			}
+			if(json) {
+				w->end_array();
+				w->end_object();
+			}
+			else {
+				std::cout << "system throughput: " << stp << " of " << tenants.size()
+					<< ", mean slowdown: " << antt << ", fairness: " << fairness << std::endl;
+			}
+		}
+
+		if(json) {
+			w->end_array();
+			w->end_object();
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	const auto& benchmarks = inncabs::registry();
+	const std::string usage = "Usage: inncabs <benchmark> [arguments...] [-- <benchmark> [arguments...]]...\n"
+		"       inncabs --mix <benchmark> [arguments...] [-- <benchmark> [arguments...]]...\n"
+		"       inncabs --list\n";
+
+	if(argc < 2) inncabs::error(usage);
+	if(std::string(argv[1]) == "--list") {
+		for(const auto& b : benchmarks) std::cout << b.first << std::endl;
+		return 0;
+	}
+	const bool mixed = std::string(argv[1]) == "--mix";
+	if(mixed && argc < 3) inncabs::error(usage);
+
+	// split the command line into the invocations of the individual benchmarks
+	std::vector<invocation> invocations(1);
+	for(int i = mixed ? 2 : 1; i < argc; ++i) {
+		if(std::string(argv[i]) == "--") invocations.emplace_back();
+		else invocations.back().push_back(argv[i]);
+	}
+	for(const auto& inv : invocations) {
+		if(inv.empty()) inncabs::error("Error: empty benchmark invocation\n");
+		if(benchmarks.find(inv[0]) == benchmarks.end()) inncabs::error("Error: unknown benchmark " + std::string(inv[0]) + ", see --list\n");
+	}
+
+	const bool json = readEnvBool(inncabs::ENV_VAR_JSON);
+
+	if(mixed) {
+		// the inputs and arguments of a benchmark are globals, so each one can only be a single tenant
+		std::vector<tenant> tenants;
+		for(const auto& inv : invocations) {
+			for(const auto& t : tenants) {
+				if(std::string(t.args[0]) == inv[0]) inncabs::error("Error: benchmark " + std::string(inv[0]) + " is part of the mix more than once\n");
+			}
+			tenant t;
+			t.args = inv;
+			tenants.push_back(t);
+		}
+		run_mix(tenants, json);
+		return 0;
+	}
+
+	if(json) std::cout << "[" << std::endl;
+	for(std::size_t i = 0; i < invocations.size(); ++i) {
+		if(json && i > 0) std::cout << "," << std::endl;
+		run(invocations[i]);
+		std::cout.flush();
+	}
+	if(json) std::cout << "]" << std::endl;
+}
@@ -4,7 +4,7 @@
 res_names = %w(clang gcc win64)
 $stddev = 1
 
-launch_types = %w(deferred optional async)
+launch_types = %w(deferred optional async pool stealing adaptive)
 benchmarks = %w(alignment fft fib floorplan health intersim nqueens pyramids qap round sort sparselu strassen uts)
 min_cpus = 1
 max_cpus = 64
@@ -8,12 +8,15 @@
 
 #include "fft.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(fft) {
 	int n = 1000;
 	if(argc > 1) n = atoi(argv[1]);
 
+	const bool dataflow = inncabs::dataflow::requested();
+
 	std::stringstream ss;
 	ss << "FFT N=" << n;
+	if(dataflow) ss << " (dataflow)";
 	
 	COMPLEX *in = NULL, *out_seq = NULL, *out = NULL;
 	in = (COMPLEX*)malloc(n * sizeof(COMPLEX));
@@ -25,7 +28,8 @@ int main(int argc, char** argv) {
 
 	inncabs::run_all(
 		[&](const std::launch l) {
-			fft(l, n, in, out);
+			if(dataflow) fft_dataflow(l, n, in, out);
+			else fft(l, n, in, out);
 			return 1;
 		},
 		[&](int result) {
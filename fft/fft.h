@@ -48,6 +48,8 @@ void fft_aux(const std::launch l, int n, COMPLEX * in, COMPLEX * out, int *facto
 void fft_aux_seq(int n, COMPLEX * in, COMPLEX * out, int *factors, COMPLEX * W, int nW);
 void fft(int n, COMPLEX * in, COMPLEX * out);
 void fft_seq(int n, COMPLEX * in, COMPLEX * out);
+inncabs::dataflow::future<void> fft_aux_dataflow(const std::launch l, int n, COMPLEX * in, COMPLEX * out, int *factors, COMPLEX * W, int nW);
+void fft_dataflow(const std::launch l, int n, COMPLEX * in, COMPLEX * out);
 bool test_correctness(int n, COMPLEX *out1, COMPLEX *out2);
 void fft_init(int n, COMPLEX *c);
 
@@ -77,8 +79,8 @@ void compute_w_coefficients(const std::launch l, int n, int a, int b, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { compute_w_coefficients(l, n, a, ab, W); } );
-		auto f2 = std::async(l, [=]() { compute_w_coefficients(l, n, ab + 1, b, W); } );
+		auto f1 = inncabs::async(l, [=]() { compute_w_coefficients(l, n, a, ab, W); } );
+		auto f2 = inncabs::async(l, [=]() { compute_w_coefficients(l, n, ab + 1, b, W); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -150,8 +152,8 @@ void unshuffle(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * out, i
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { unshuffle(l, a, ab, in, out, r, m); } );
-		auto f2 = std::async(l, [=]() { unshuffle(l, ab, b, in, out, r, m); } );
+		auto f1 = inncabs::async(l, [=]() { unshuffle(l, a, ab, in, out, r, m); } );
+		auto f2 = inncabs::async(l, [=]() { unshuffle(l, ab, b, in, out, r, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -217,8 +219,8 @@ void fft_twiddle_gen(const std::launch l, int i, int i1, COMPLEX * in, COMPLEX *
 		fft_twiddle_gen1(in + i, out + i, W, r, m, nW, nWdn * i, nWdn * m);
 	} else {
 		int i2 = (i + i1) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_gen(l, i, i2, in, out, W, nW, nWdn, r, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_gen(l, i2, i1, in, out, W, nW, nWdn, r, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_gen(l, i, i2, in, out, W, nW, nWdn, r, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_gen(l, i2, i1, in, out, W, nW, nWdn, r, m); } );
 		f1.wait(); f2.wait();
 	}
 	return;
@@ -277,8 +279,8 @@ void fft_twiddle_2(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * ou
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_2(l, a, ab, in, out, W, nW, nWdn, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_2(l, ab, b, in, out, W, nW, nWdn, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_2(l, a, ab, in, out, W, nW, nWdn, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_2(l, ab, b, in, out, W, nW, nWdn, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -329,8 +331,8 @@ void fft_unshuffle_2(const std::launch l, int a, int b, COMPLEX * in, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_unshuffle_2(l, a, ab, in, out, m); } );
-		auto f2 = std::async(l, [=]() { fft_unshuffle_2(l, ab, b, in, out, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_unshuffle_2(l, a, ab, in, out, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_unshuffle_2(l, ab, b, in, out, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -454,8 +456,8 @@ void fft_twiddle_4(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * ou
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_4(l, a, ab, in, out, W, nW, nWdn, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_4(l, ab, b, in, out, W, nW, nWdn, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_4(l, a, ab, in, out, W, nW, nWdn, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_4(l, ab, b, in, out, W, nW, nWdn, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -544,8 +546,8 @@ void fft_unshuffle_4(const std::launch l, int a, int b, COMPLEX * in, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_unshuffle_4(l, a, ab, in, out, m); } );
-		auto f2 = std::async(l, [=]() { fft_unshuffle_4(l, ab, b, in, out, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_unshuffle_4(l, a, ab, in, out, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_unshuffle_4(l, ab, b, in, out, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -828,8 +830,8 @@ void fft_twiddle_8(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * ou
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_8(l, a, ab, in, out, W, nW, nWdn, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_8(l, ab, b, in, out, W, nW, nWdn, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_8(l, a, ab, in, out, W, nW, nWdn, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_8(l, ab, b, in, out, W, nW, nWdn, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -1010,8 +1012,8 @@ void fft_unshuffle_8(const std::launch l, int a, int b, COMPLEX * in, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_unshuffle_8(l, a, ab, in, out, m); } );
-		auto f2 = std::async(l, [=]() { fft_unshuffle_8(l, ab, b, in, out, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_unshuffle_8(l, a, ab, in, out, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_unshuffle_8(l, ab, b, in, out, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -1670,8 +1672,8 @@ void fft_twiddle_16(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * o
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_16(l, a, ab, in, out, W, nW, nWdn, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_16(l, ab, b, in, out, W, nW, nWdn, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_16(l, a, ab, in, out, W, nW, nWdn, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_16(l, ab, b, in, out, W, nW, nWdn, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -2068,8 +2070,8 @@ void fft_unshuffle_16(const std::launch l, int a, int b, COMPLEX * in, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_unshuffle_16(l, a, ab, in, out, m); } );
-		auto f2 = std::async(l, [=]() { fft_unshuffle_16(l, ab, b, in, out, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_unshuffle_16(l, a, ab, in, out, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_unshuffle_16(l, ab, b, in, out, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -3608,8 +3610,8 @@ void fft_twiddle_32(const std::launch l, int a, int b, COMPLEX * in, COMPLEX * o
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_twiddle_32(l, a, ab, in, out, W, nW, nWdn, m); } );
-		auto f2 = std::async(l, [=]() { fft_twiddle_32(l, ab, b, in, out, W, nW, nWdn, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_twiddle_32(l, a, ab, in, out, W, nW, nWdn, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_twiddle_32(l, ab, b, in, out, W, nW, nWdn, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -4502,8 +4504,8 @@ void fft_unshuffle_32(const std::launch l, int a, int b, COMPLEX * in, COMPLEX *
 		}
 	} else {
 		int ab = (a + b) / 2;
-		auto f1 = std::async(l, [=]() { fft_unshuffle_32(l, a, ab, in, out, m); } );
-		auto f2 = std::async(l, [=]() { fft_unshuffle_32(l, ab, b, in, out, m); } );
+		auto f1 = inncabs::async(l, [=]() { fft_unshuffle_32(l, a, ab, in, out, m); } );
+		auto f2 = inncabs::async(l, [=]() { fft_unshuffle_32(l, ab, b, in, out, m); } );
 		f1.wait(); f2.wait();
 	}
 }
@@ -4659,9 +4661,9 @@ void fft_aux(const std::launch l, int n, COMPLEX * in, COMPLEX * out, int *facto
 		for (k = 0; k < n; k += m) {
 			fft_aux(l, m, out + k, in + k, factors + 1, W, nW);
 		}
-		//std::vector<std::future<void>> futures;
+		//std::vector<inncabs::future<void>> futures;
 		//for (k = 0; k < n; k += m) {
-		//	futures.push_back( std::async(l, fft_aux, l, m, out + k, in + k, factors + 1, W, nW) );
+		//	futures.push_back( inncabs::async(l, fft_aux, l, m, out + k, in + k, factors + 1, W, nW) );
 		//}
 		//for(auto &f : futures) {
 		//	f.wait();
@@ -4749,6 +4751,105 @@ void fft_aux_seq(int n, COMPLEX * in, COMPLEX * out, int *factors, COMPLEX * W,
 
 	return;
 }
+/*
+* Continuation-style variant of fft_aux. The parallel kernels all split their
+* range in halves down to 128 elements, fft_range_dataflow does the same with
+* dataflow::async and calls the sequential kernel on the leaves. Each step of
+* fft_aux is attached to the completion of the previous one instead of waiting
+* for it; like fft_aux, the sub-transforms run one after another.
+*/
+template<typename Kernel>
+inncabs::dataflow::future<void> fft_range_dataflow(const std::launch l, int a, int b, Kernel kernel) {
+	if ((b - a) < 128) {
+		kernel(a, b);
+		return inncabs::dataflow::make_ready_future();
+	}
+	int ab = (a + b) / 2;
+	auto f1 = inncabs::dataflow::async(l, fft_range_dataflow<Kernel>, l, a, ab, kernel);
+	auto f2 = inncabs::dataflow::async(l, fft_range_dataflow<Kernel>, l, ab, b, kernel);
+	return inncabs::dataflow::when_all(f1, f2);
+}
+
+inncabs::dataflow::future<void> fft_aux_dataflow(const std::launch l, int n, COMPLEX * in, COMPLEX * out, int *factors, COMPLEX * W, int nW)
+{
+	using inncabs::dataflow::future;
+
+	/* special cases */
+	if (n == 32 || n == 16 || n == 8 || n == 4 || n == 2) {
+		if      (n == 32) fft_base_32(in, out);
+		else if (n == 16) fft_base_16(in, out);
+		else if (n ==  8) fft_base_8(in, out);
+		else if (n ==  4) fft_base_4(in, out);
+		else              fft_base_2(in, out);
+		return inncabs::dataflow::make_ready_future();
+	}
+
+	int r = *factors;
+	int m = n / r;
+
+	/* 
+	* multiply by the twiddle factors, and perform m FFTs
+	* of length r
+	*/
+	auto twiddle = [=](future<void>) {
+		return fft_range_dataflow(l, 0, m, [=](int a, int b) {
+			if      (r ==  2) fft_twiddle_2_seq(a, b, in, out, W, nW, nW / n, m);
+			else if (r ==  4) fft_twiddle_4_seq(a, b, in, out, W, nW, nW / n, m);
+			else if (r ==  8) fft_twiddle_8_seq(a, b, in, out, W, nW, nW / n, m);
+			else if (r == 16) fft_twiddle_16_seq(a, b, in, out, W, nW, nW / n, m);
+			else if (r == 32) fft_twiddle_32_seq(a, b, in, out, W, nW, nW / n, m);
+			else              fft_twiddle_gen_seq(a, b, in, out, W, nW, nW / n, r, m);
+		});
+	};
+
+	if (r < n) {
+		/* 
+		* split the DFT of length n into r DFTs of length n/r,  and
+		* recurse 
+		*/
+		future<void> step = fft_range_dataflow(l, 0, m, [=](int a, int b) {
+			if      (r == 32) fft_unshuffle_32_seq(a, b, in, out, m);
+			else if (r == 16) fft_unshuffle_16_seq(a, b, in, out, m);
+			else if (r ==  8) fft_unshuffle_8_seq(a, b, in, out, m);
+			else if (r ==  4) fft_unshuffle_4_seq(a, b, in, out, m);
+			else if (r ==  2) fft_unshuffle_2_seq(a, b, in, out, m);
+			else              unshuffle_seq(a, b, in, out, r, m);
+		});
+		for (int k = 0; k < n; k += m) {
+			step = step.then([=](future<void>) { return fft_aux_dataflow(l, m, out + k, in + k, factors + 1, W, nW); });
+		}
+		return step.then(twiddle);
+	}
+	return twiddle(inncabs::dataflow::make_ready_future());
+}
+
+void fft_dataflow(const std::launch lt, int n, COMPLEX * in, COMPLEX * out) {
+	int factors[40];		/* allows FFTs up to at least 3^40 */
+	int *p = factors;
+	int l = n;
+	int r;
+	COMPLEX *W;
+
+	inncabs::message("Computing coefficients ");
+	W = (COMPLEX *) malloc((n + 1) * sizeof(COMPLEX));
+	/* compute_w_coefficients works on the closed range [a, b] */
+	fft_range_dataflow(lt, 0, n / 2 + 1, [=](int a, int b) { compute_w_coefficients_seq(n, a, b - 1, W); }).get();
+	inncabs::message(" completed!\n");
+	
+	do {
+		r = factor(l);
+		*p++ = r;
+		l /= r;
+	} while (l > 1);
+
+	inncabs::message("Computing FFT (dataflow) ");
+	fft_aux_dataflow(lt, n, in, out, factors, W, n).get();
+	inncabs::message(" completed!\n");
+	
+	free(W);
+	return;
+}
+
 /*
 * user interface for fft_aux
 */
@@ -1,34 +1,175 @@
 #include "../include/inncabs.h"
 
+#include <array>
+
 typedef long long ll;
 
-ll fib(int n, const std::launch l) {
+// below the cut-off, fib is computed sequentially
+static int arg_cutoff = 2;
+
+ll fib_seq(int n) {
 	if(n < 2) return n;
+	return fib_seq(n - 1) + fib_seq(n - 2);
+}
 
-	auto x = std::async(l, fib, n - 1, l);
-	auto y = std::async(l, fib, n - 2, l);
+ll fib(int n, const std::launch l) {
+	if(n < arg_cutoff) return fib_seq(n);
+
+	auto x = inncabs::async(l, fib, n - 1, l);
+	auto y = inncabs::async(l, fib, n - 2, l);
 
 	return x.get() + y.get();
 }
 
-static const ll FIB_RESULTS_PRE = 41;
-static const ll fib_results[FIB_RESULTS_PRE] = {0,1,1,2,3,5,8,13,21,34,55,89,144,233,377,610,987,1597,2584,4181,6765,10946,17711,28657,46368,75025,121393,196418,317811,514229,832040,1346269,2178309,3524578,5702887,9227465,14930352,24157817,39088169,63245986,102334155};
+// spawns only one child, and computes the other one on the calling task
+ll fib_one(int n, const std::launch l) {
+	if(n < arg_cutoff) return fib_seq(n);
+
+	auto x = inncabs::async(l, fib_one, n - 1, l);
+	ll y = fib_one(n - 2, l);
+
+	return x.get() + y;
+}
+
+ll empty_task() {
+	return 1;
+}
+
+// spawns the given number of empty tasks, each one joined before the next one is spawned
+ll spawn_join(ll tasks, const std::launch l) {
+	ll joined = 0;
+	for(ll i = 0; i < tasks; ++i) {
+		joined += inncabs::async(l, empty_task).get();
+	}
+	return joined;
+}
+
+#ifdef INNCABS_COROUTINES
+inncabs::coro::task<ll> fib_coro(int n) {
+	if(n < arg_cutoff) co_return fib_seq(n);
+
+	auto x = inncabs::coro::spawn(fib_coro(n - 1));
+	auto y = inncabs::coro::spawn(fib_coro(n - 2));
+
+	co_return co_await x + co_await y;
+}
+
+inncabs::coro::task<ll> fib_one_coro(int n) {
+	if(n < arg_cutoff) co_return fib_seq(n);
 
+	auto x = inncabs::coro::spawn(fib_one_coro(n - 1));
+	ll y = co_await fib_one_coro(n - 2);
+
+	co_return co_await x + y;
+}
+
+inncabs::coro::task<ll> empty_task_coro() {
+	co_return 1;
+}
+
+inncabs::coro::task<ll> spawn_join_coro(ll tasks) {
+	ll joined = 0;
+	for(ll i = 0; i < tasks; ++i) {
+		joined += co_await inncabs::coro::spawn(empty_task_coro());
+	}
+	co_return joined;
+}
+#endif
+
+// number of tasks spawned by fib(n), with the given number of spawns per node above the cut-off
+ll task_count(int n, int spawns) {
+	ll previous = 0, current = 0;
+	for(int i = 0; i <= n; ++i) {
+		ll next = i < arg_cutoff ? 0 : spawns + current + previous;
+		previous = current;
+		current = next;
+	}
+	return current;
+}
+
+// fib(n) for all n whose value fits into a long long, generated at compile time
+static const int FIB_RESULTS_PRE = 93;
+
+constexpr ll fib_iter(int n, ll current = 0, ll next = 1) {
+	return n == 0 ? current : n == 1 ? next : fib_iter(n - 1, next, current + next);
+}
+
+template<int... I>
+struct indices {};
+template<int N, int... I>
+struct make_indices : make_indices<N - 1, N - 1, I...> {};
+template<int... I>
+struct make_indices<0, I...> { using type = indices<I...>; };
+
+template<int... I>
+constexpr std::array<ll, sizeof...(I)> fib_table(indices<I...>) {
+	return std::array<ll, sizeof...(I)> {{ fib_iter(I)... }};
+}
+
+static constexpr std::array<ll, FIB_RESULTS_PRE> fib_results = fib_table(make_indices<FIB_RESULTS_PRE>::type());
+
+// fib(n), or -1 if it does not fit into a long long
 ll fib_verify_value(int n) {
-	if(n < FIB_RESULTS_PRE) return fib_results[n];
-	return fib_verify_value(n-1) + fib_verify_value(n-2);
+	if(n < 0 || n >= FIB_RESULTS_PRE) return -1;
+	return fib_results[n];
 }
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(fib) {
 	int n = 12;
 	if(argc > 1) n = atoi(argv[1]);
+	if(argc > 2) arg_cutoff = std::max(2, atoi(argv[2]));
+	std::string variant = "both";
+	if(argc > 3) variant = argv[3];
+	if(variant != "both" && variant != "one" && variant != "empty") {
+		inncabs::error("Error: unknown variant " + variant + ", expected both, one or empty\n");
+	}
+
+	// the empty variant spawns as many tasks as the both variant
+	const ll tasks = task_count(n, variant == "one" ? 1 : 2);
+	if(fib_verify_value(n) < 0) {
+		inncabs::error("Error: fib(" + std::to_string(n) + ") does not fit into 64 bits\n");
+	}
+	// computed once, outside of the timed region
+	const ll expected = variant == "empty" ? tasks : fib_verify_value(n);
 
 	std::stringstream ss;
 	ss << "Fibonacci N=" << n;
+	if(arg_cutoff > 2) ss << " cut-off " << arg_cutoff;
+	if(variant == "one") ss << " (one spawn per node)";
+	if(variant == "empty") ss << " (" << tasks << " empty tasks)";
+
+	auto run = [n, variant, tasks](const std::launch l) -> ll {
+		if(variant == "one") return fib_one(n, l);
+		if(variant == "empty") return spawn_join(tasks, l);
+		return fib(n, l);
+	};
 
-	inncabs::run_all(
-		[n](const std::launch l) { return fib(n, l); },
-		[n](ll result) { return result == fib_verify_value(n); },
-		ss.str() 
-		);
+	if(inncabs::service::requested()) {
+		// every request runs the selected variant once
+		inncabs::serve(
+			[run](const std::launch l, unsigned long long) { return run(l); },
+			[expected](unsigned long long, ll result) { return result == expected; },
+			ss.str()
+			);
+	}
+	else {
+#ifdef INNCABS_COROUTINES
+		inncabs::coro::declare_variant();
+#endif
+		inncabs::declare_work("task", static_cast<double>(tasks));
+		inncabs::run_all(
+			[n, variant, tasks, run](const std::launch l) {
+#ifdef INNCABS_COROUTINES
+				if(l == inncabs::launch::coroutine) {
+					if(variant == "one") return inncabs::coro::run(fib_one_coro(n));
+					if(variant == "empty") return inncabs::coro::run(spawn_join_coro(tasks));
+					return inncabs::coro::run(fib_coro(n));
+				}
+#endif
+				return run(l);
+			},
+			[expected](ll result) { return result == expected; },
+			ss.str() 
+			);
+	}
 }
@@ -9,7 +9,7 @@
 
 #include "floorplan.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(floorplan) {
 	const char* fn = "input/floorplan/input.5";
 	if(argc > 1) fn = argv[1];
 
@@ -190,7 +190,7 @@ int add_cell(const std::launch l, int id, coor FOOTPRINT, ibrd BOARD, struct cel
 	std::atomic_int_least32_t nnc { 0 };
 
 	std::mutex m;
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 
 	/* for each possible shape */
 	for (i = 0; i < CELLS[id].n; i++) {
@@ -199,7 +199,7 @@ int add_cell(const std::launch l, int id, coor FOOTPRINT, ibrd BOARD, struct cel
 		nnl += nn;
 		/* for all possible locations */
 		for (j = 0; j < nn; j++) {
-			futures.push_back( std::async(l, [&, i, j, id, nn]() mutable {
+			futures.push_back( inncabs::async(l, [&, i, j, id, nn]() mutable {
 				ibrd board;
 				coor footprint;
 				struct cell* cells = (struct cell*)alloca((N + 1)*sizeof(struct cell));
@@ -8,7 +8,7 @@
 
 #include "health.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(health) {
 	const char* fn = "input/health/test.input";
 	if(argc > 1) fn = argv[1];
 
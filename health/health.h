@@ -470,12 +470,12 @@ void sim_village_par(const std::launch l, struct Village *village)
 	// recursive call cannot occurs
 	if (village == NULL) return;
 
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 	/* Traverse village hierarchy (lower level first)*/
 	vlist = village->forward;
 	while(vlist) {
 		//#pragma omp task untied
-		futures.push_back(std::async(l, sim_village_par, l, vlist));
+		futures.push_back(inncabs::async(l, sim_village_par, l, vlist));
 		vlist = vlist->next;
 	}
 
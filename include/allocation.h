@@ -0,0 +1,281 @@
+#pragma once
+
+/*
+ * Allocation profiling
+ *
+ * When enabled (INNCABS_ALLOC_STATS), every heap allocation during a timed repetition is counted,
+ * together with the number of requested bytes and the number of frees. The counters are striped over
+ * cache-line sized slots, one per thread as long as there are fewer threads than slots, so that
+ * allocating threads do not contend on a shared counter. The peak resident set size of each
+ * repetition is taken from VmHWM in /proc/self/status, which is reset before every repetition, or
+ * from getrusage where resetting is not possible (in which case it is the peak of the process).
+ *
+ * With glibc, malloc, calloc, realloc, free and the aligned allocation functions are interposed, which
+ * also covers operator new and the standard containers. Elsewhere, the global operator new and delete
+ * are replaced instead. Memory obtained directly from the OS (e.g. numa::alloc with a placement policy)
+ * is not counted. The hooks are linked into every benchmark, also when the statistics are disabled,
+ * where they add a relaxed atomic load and a branch to every allocation and free.
+ */
+
+#include <atomic>
+#include <new>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "platform.h"
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace inncabs {
+
+	struct AllocStats {
+		unsigned long long allocations;
+		unsigned long long frees;
+		unsigned long long bytes;
+		unsigned long long peak_rss_kb;
+	};
+
+	namespace allocation {
+		namespace detail {
+			const unsigned NUM_SLOTS = 128;
+
+			struct padded_slot {
+				std::atomic<unsigned long long> allocations;
+				std::atomic<unsigned long long> frees;
+				std::atomic<unsigned long long> bytes;
+				char padding[64 - 3 * sizeof(std::atomic<unsigned long long>)];
+			};
+
+			// all of these are constant-initialized, so that they can be used during static initialization
+			inline padded_slot* slots() {
+				static padded_slot s[NUM_SLOTS];
+				return s;
+			}
+
+			inline std::atomic<bool>& counting() {
+				static std::atomic<bool> flag(false);
+				return flag;
+			}
+
+			inline bool& enabled_flag() {
+				static bool flag = false;
+				return flag;
+			}
+
+			// set while the calling thread allocates on behalf of the harness, see uncounted_scope
+			inline bool& suspended() {
+				static INNCABS_THREAD_LOCAL bool flag = false;
+				return flag;
+			}
+
+			inline padded_slot& local_slot() {
+				// no dynamic initialization, which could allocate itself
+				static INNCABS_THREAD_LOCAL unsigned slot = 0;
+				static std::atomic<unsigned> next_slot(0);
+				if(slot == 0) slot = next_slot.fetch_add(1, std::memory_order_relaxed) % NUM_SLOTS + 1;
+				return slots()[slot - 1];
+			}
+
+			inline void count_alloc(std::size_t size) {
+				if(!counting().load(std::memory_order_relaxed) || suspended()) return;
+				padded_slot& s = local_slot();
+				s.allocations.fetch_add(1, std::memory_order_relaxed);
+				s.bytes.fetch_add(size, std::memory_order_relaxed);
+			}
+
+			inline void count_free(void* p) {
+				if(!p || !counting().load(std::memory_order_relaxed) || suspended()) return;
+				local_slot().frees.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// VmHWM in kB, or 0 if not available
+			inline unsigned long long read_hwm() {
+				std::ifstream status("/proc/self/status");
+				std::string line;
+				while(std::getline(status, line)) {
+					if(line.compare(0, 6, "VmHWM:") == 0) return std::strtoull(line.c_str() + 6, nullptr, 10);
+				}
+				return 0;
+			}
+
+			// resets VmHWM to the current resident set size, supported since Linux 4.0
+			inline bool reset_hwm() {
+				std::ofstream clear("/proc/self/clear_refs");
+				clear << "5";
+				clear.flush();
+				return static_cast<bool>(clear);
+			}
+		}
+
+		inline bool enabled() {
+			return detail::enabled_flag();
+		}
+
+		inline void enable(bool on) {
+			detail::enabled_flag() = on;
+		}
+
+		// allocations and frees of the calling thread are not counted for the lifetime of the scope,
+		// used for memory of the harness itself, such as trace buffers
+		class uncounted_scope {
+		public:
+			uncounted_scope() : previous(detail::suspended()) { detail::suspended() = true; }
+			~uncounted_scope() { detail::suspended() = previous; }
+		private:
+			uncounted_scope(const uncounted_scope&);
+			uncounted_scope& operator=(const uncounted_scope&);
+			bool previous;
+		};
+
+		// counts allocations between start() and stop(), for all threads of the process
+		class session {
+		public:
+			session() : active(false), hwm_reset(false) {}
+
+			void start() {
+				for(unsigned i = 0; i < detail::NUM_SLOTS; ++i) {
+					detail::slots()[i].allocations.store(0);
+					detail::slots()[i].frees.store(0);
+					detail::slots()[i].bytes.store(0);
+				}
+				#if defined(__linux__)
+				hwm_reset = detail::reset_hwm();
+				#endif
+				active = true;
+				detail::counting().store(true);
+			}
+
+			AllocStats stop() {
+				AllocStats stats = { 0, 0, 0, 0 };
+				if(!active) return stats;
+				detail::counting().store(false);
+				for(unsigned i = 0; i < detail::NUM_SLOTS; ++i) {
+					stats.allocations += detail::slots()[i].allocations.load();
+					stats.frees += detail::slots()[i].frees.load();
+					stats.bytes += detail::slots()[i].bytes.load();
+				}
+				#if defined(__linux__)
+				if(hwm_reset) stats.peak_rss_kb = detail::read_hwm();
+				if(stats.peak_rss_kb == 0) {
+					rusage usage;
+					if(getrusage(RUSAGE_SELF, &usage) == 0) stats.peak_rss_kb = static_cast<unsigned long long>(usage.ru_maxrss);
+				}
+				#endif
+				active = false;
+				return stats;
+			}
+
+		private:
+			bool active;
+			bool hwm_reset;
+		};
+
+		// per-field mean over several sessions
+		inline AllocStats average(const std::vector<AllocStats>& runs) {
+			AllocStats avg = { 0, 0, 0, 0 };
+			if(runs.empty()) return avg;
+			for(const auto& r : runs) {
+				avg.allocations += r.allocations;
+				avg.frees += r.frees;
+				avg.bytes += r.bytes;
+				avg.peak_rss_kb += r.peak_rss_kb;
+			}
+			avg.allocations /= runs.size();
+			avg.frees /= runs.size();
+			avg.bytes /= runs.size();
+			avg.peak_rss_kb /= runs.size();
+			return avg;
+		}
+	}
+}
+
+// the hooks are defined in the translation unit containing main only, see INNCABS_MAIN
+#if defined(INNCABS_DRIVER)
+#elif defined(__GLIBC__)
+extern "C" {
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* p, size_t size);
+	void* __libc_memalign(size_t alignment, size_t size);
+	void* __libc_valloc(size_t size);
+	void* __libc_pvalloc(size_t size);
+	void __libc_free(void* p);
+
+	void* malloc(size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t n, size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(n * size);
+		return __libc_calloc(n, size);
+	}
+
+	void* realloc(void* p, size_t size) __THROW {
+		inncabs::allocation::detail::count_free(p);
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_realloc(p, size);
+	}
+
+	// blocks of the aligned functions are released with free, so they are counted as well
+	void* memalign(size_t alignment, size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_memalign(alignment, size);
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_memalign(alignment, size);
+	}
+
+	int posix_memalign(void** p, size_t alignment, size_t size) __THROW {
+		if(alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0) return EINVAL;
+		inncabs::allocation::detail::count_alloc(size);
+		void* mem = __libc_memalign(alignment, size);
+		if(!mem) return ENOMEM;
+		*p = mem;
+		return 0;
+	}
+
+	void* valloc(size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_valloc(size);
+	}
+
+	void* pvalloc(size_t size) __THROW {
+		inncabs::allocation::detail::count_alloc(size);
+		return __libc_pvalloc(size);
+	}
+
+	void free(void* p) __THROW {
+		inncabs::allocation::detail::count_free(p);
+		__libc_free(p);
+	}
+}
+#else
+void* operator new(std::size_t size) {
+	inncabs::allocation::detail::count_alloc(size);
+	void* p = std::malloc(size ? size : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+	inncabs::allocation::detail::count_free(p);
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+	operator delete(p);
+}
+#endif
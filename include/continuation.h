@@ -0,0 +1,469 @@
+#pragma once
+
+/*
+ * Continuation-style futures
+ *
+ * A task using inncabs::future waits for its children: it blocks, or on a pool worker helps, until
+ * they have finished. The futures of inncabs::dataflow are never waited on by a task. Work depending on
+ * a result is attached to its future with then(), or to several futures with when_all(), and runs as
+ * soon as the last of its inputs is ready, on the thread which completed it. Only the root of a
+ * computation calls get(), which blocks the calling thread.
+ *
+ * dataflow::async spawns a function with the same launch policies as inncabs::async: the executor
+ * policies submit a task to the current executor, async and optional start a thread of its own, which
+ * is joined at the end of the enclosing thread_scope (see thread_registry.h), and deferred runs the
+ * function inline. then(l, f) schedules f the same way once the future is ready,
+ * then(f) runs it inline. Functions returning a dataflow::future are unwrapped, the returned future
+ * becomes ready once the inner one is.
+ *
+ * Benchmarks with a continuation-style variant run it instead of the blocking one when INNCABS_DATAFLOW
+ * is set.
+ *
+ * Included by inncabs.h, after the definitions it builds on.
+ */
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <tuple>
+#include <new>
+
+#include "executor.h"
+#include "instrumentation.h"
+#include "tracing.h"
+#include "thread_registry.h"
+
+namespace inncabs {
+	namespace dataflow {
+		const static char* ENV_VAR_DATAFLOW = "INNCABS_DATAFLOW";
+
+		// whether the continuation-style variants were requested for this process
+		inline bool requested() {
+			return readEnvBool(ENV_VAR_DATAFLOW);
+		}
+
+		template<typename T>
+		class future;
+
+		namespace detail {
+			// work attached to a shared state, runs once and deletes itself
+			class continuation {
+			public:
+				continuation() : next(nullptr) {}
+				virtual ~continuation() {}
+				virtual void run() = 0;
+				continuation* next;
+			};
+
+			template<typename F>
+			class callback : public continuation {
+			public:
+				explicit callback(F&& f) : fun(std::move(f)) {}
+				void run() override {
+					fun();
+					delete this;
+				}
+			private:
+				F fun;
+			};
+
+			template<typename F>
+			continuation* make_callback(F&& f) {
+				typename std::decay<F>::type fun(std::forward<F>(f));
+				return new callback<typename std::decay<F>::type>(std::move(fun));
+			}
+
+			// marks the continuation list of a state which has completed
+			inline continuation* closed() {
+				struct sentinel : continuation {
+					void run() override {}
+				};
+				static sentinel s;
+				return &s;
+			}
+
+			// completion, error and continuations of a future, the continuations form a lock-free stack
+			class state_base {
+			public:
+				state_base() : pending(nullptr) {}
+
+				bool ready() const { return pending.load(std::memory_order_acquire) == closed(); }
+
+				// runs c once the state has completed, right away if it already has
+				void attach(continuation* c) {
+					continuation* head = pending.load(std::memory_order_acquire);
+					do {
+						if(head == closed()) {
+							c->run();
+							return;
+						}
+						c->next = head;
+					} while(!pending.compare_exchange_weak(head, c, std::memory_order_acq_rel, std::memory_order_acquire));
+				}
+
+				void store_error(std::exception_ptr e) { error = e; }
+				std::exception_ptr stored_error() const { return error; }
+
+				// publishes the result and runs the attached continuations, in the order they were attached
+				void complete() {
+					continuation* c = pending.exchange(closed(), std::memory_order_acq_rel);
+					continuation* ordered = nullptr;
+					while(c) {
+						continuation* n = c->next;
+						c->next = ordered;
+						ordered = c;
+						c = n;
+					}
+					while(ordered) {
+						continuation* n = ordered->next;
+						ordered->run();
+						ordered = n;
+					}
+				}
+
+			protected:
+				void rethrow() const {
+					if(error) std::rethrow_exception(error);
+				}
+
+			private:
+				std::atomic<continuation*> pending;
+				std::exception_ptr error;
+			};
+
+			template<typename T>
+			class state : public state_base {
+			public:
+				using reference = const T&;
+				state() : has_value(false) {}
+				~state() {
+					if(has_value) reinterpret_cast<T*>(&storage)->~T();
+				}
+				void store(T&& v) {
+					new (&storage) T(std::move(v));
+					has_value = true;
+				}
+				// copies the result of another, completed state
+				void store_result(const state& other) {
+					if(other.stored_error()) store_error(other.stored_error());
+					else store(T(*reinterpret_cast<const T*>(&other.storage)));
+				}
+				reference get() const {
+					rethrow();
+					return *reinterpret_cast<const T*>(&storage);
+				}
+			private:
+				typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+				bool has_value;
+			};
+
+			template<>
+			class state<void> : public state_base {
+			public:
+				using reference = void;
+				void store_result(const state& other) {
+					if(other.stored_error()) store_error(other.stored_error());
+				}
+				void get() const { rethrow(); }
+			};
+
+			template<typename R>
+			struct unwrap {
+				using type = R;
+			};
+			template<typename U>
+			struct unwrap<future<U>> {
+				using type = U;
+			};
+
+			// calls f and completes s with its result, or with the exception it threw
+			template<typename R>
+			struct resolver {
+				template<typename F>
+				static void run(const std::shared_ptr<state<R>>& s, F& f) {
+					try {
+						s->store(f());
+					}
+					catch(...) {
+						s->store_error(std::current_exception());
+					}
+					s->complete();
+				}
+			};
+
+			template<>
+			struct resolver<void> {
+				template<typename F>
+				static void run(const std::shared_ptr<state<void>>& s, F& f) {
+					try {
+						f();
+					}
+					catch(...) {
+						s->store_error(std::current_exception());
+					}
+					s->complete();
+				}
+			};
+
+			// f returns a future, s completes once that one has
+			template<typename U>
+			struct resolver<future<U>> {
+				template<typename F>
+				static void run(const std::shared_ptr<state<U>>& s, F& f) {
+					future<U> inner;
+					try {
+						inner = f();
+					}
+					catch(...) {
+						s->store_error(std::current_exception());
+						s->complete();
+						return;
+					}
+					std::shared_ptr<state<U>> in = inner.shared_state();
+					in->attach(make_callback([in, s] {
+						s->store_result(*in);
+						s->complete();
+					}));
+				}
+			};
+
+			// task running a continuation-style function on an executor, deletes itself once done
+			template<typename F>
+			class detached_task : public inncabs::detail::task_base {
+			public:
+				explicit detached_task(F&& f) : fun(std::move(f)) {}
+				void execute() override {
+					fun();
+					delete this;
+				}
+			private:
+				F fun;
+			};
+
+			template<typename F>
+			void launch(const std::launch l, F&& f) {
+				using Fn = typename std::decay<F>::type;
+				if(is_executor_launch(l)) {
+					executor* e = inncabs::detail::current_executor();
+					if(!e) {
+						std::cerr << "inncabs::dataflow: no executor installed for launch policy " << static_cast<int>(l) << std::endl;
+						exit(-1);
+					}
+					Fn fun(std::forward<F>(f));
+					e->submit(new detached_task<Fn>(std::move(fun)));
+				}
+				else if((static_cast<int>(l) & static_cast<int>(std::launch::async)) != 0) {
+					start_thread(std::forward<F>(f));
+				}
+				else {
+					Fn fun(std::forward<F>(f));
+					fun();
+				}
+			}
+
+			// runs f according to the launch policy, without a future to wait on
+			template<typename F>
+			void schedule(const std::launch l, F&& f) {
+				if(tracing::enabled()) {
+					if(instrumentation::enabled()) launch(l, tracing::wrap(instrumentation::wrap(std::forward<F>(f))));
+					else launch(l, tracing::wrap(std::forward<F>(f)));
+				}
+				else if(instrumentation::enabled()) launch(l, instrumentation::wrap(std::forward<F>(f)));
+				else launch(l, std::forward<F>(f));
+			}
+
+			// stores decayed copies of the function and its arguments, like inncabs::async does
+			template<typename R, typename Function, typename... Args>
+			class spawned_call {
+			public:
+				using T = typename unwrap<R>::type;
+				template<typename F, typename... A>
+				spawned_call(const std::shared_ptr<state<T>>& s, F&& f, A&&... a) : result(s), fun(std::forward<F>(f)), args(std::forward<A>(a)...) {}
+				void operator()() {
+					auto call = [this]() { return invoke(inncabs::detail::make_index_sequence<sizeof...(Args)>()); };
+					resolver<R>::run(result, call);
+				}
+			private:
+				template<std::size_t... I>
+				R invoke(inncabs::detail::index_sequence<I...>) {
+					return fun(std::move(std::get<I>(args))...);
+				}
+				std::shared_ptr<state<T>> result;
+				Function fun;
+				std::tuple<Args...> args;
+			};
+
+			// function attached to a future with then, called with the ready future
+			template<typename R, typename Function, typename T>
+			class continuation_call {
+			public:
+				using U = typename unwrap<R>::type;
+				template<typename F>
+				continuation_call(const std::shared_ptr<state<U>>& s, F&& f, const future<T>& in) : result(s), fun(std::forward<F>(f)), input(in) {}
+				void operator()() {
+					auto call = [this]() { return fun(input); };
+					resolver<R>::run(result, call);
+				}
+			private:
+				std::shared_ptr<state<U>> result;
+				Function fun;
+				future<T> input;
+			};
+
+			template<typename Call>
+			class scheduled_call {
+			public:
+				scheduled_call(const std::launch policy, Call&& c) : l(policy), call(std::move(c)) {}
+				void operator()() { schedule(l, std::move(call)); }
+			private:
+				std::launch l;
+				Call call;
+			};
+
+			// counts down the inputs of when_all, the first error is kept
+			struct join_state {
+				join_state(std::size_t n, const std::shared_ptr<state<void>>& s) : remaining(n), failed(false), result(s) {}
+				std::atomic<std::size_t> remaining;
+				std::atomic<bool> failed;
+				std::shared_ptr<state<void>> result;
+			};
+
+			struct join_arrival {
+				void operator()() {
+					if(input->stored_error() && !join->failed.exchange(true)) join->result->store_error(input->stored_error());
+					if(join->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) join->result->complete();
+				}
+				std::shared_ptr<join_state> join;
+				std::shared_ptr<state_base> input;
+			};
+
+			inline void join_all(const std::shared_ptr<join_state>&) {}
+
+			template<typename T, typename... Rest>
+			void join_all(const std::shared_ptr<join_state>& j, const future<T>& f, const Rest&... rest) {
+				join_arrival arrival = { j, f.shared_state() };
+				f.shared_state()->attach(make_callback(std::move(arrival)));
+				join_all(j, rest...);
+			}
+		}
+
+		// handle of a result computed by dataflow::async or a continuation, copies share the result
+		template<typename T>
+		class future {
+		public:
+			future() {}
+			explicit future(const std::shared_ptr<detail::state<T>>& s) : s(s) {}
+
+			bool valid() const { return s != nullptr; }
+			bool is_ready() const { return s && s->ready(); }
+
+			// blocks the calling thread, meant for the root of a computation: a task calling it holds its worker
+			void wait() const {
+				if(s->ready()) return;
+				tracing::wait_scope traced;
+				std::mutex m;
+				std::condition_variable cv;
+				bool done = false;
+				s->attach(detail::make_callback([&m, &cv, &done] {
+					std::lock_guard<std::mutex> lock(m);
+					done = true;
+					cv.notify_all();
+				}));
+				std::unique_lock<std::mutex> lock(m);
+				cv.wait(lock, [&done] { return done; });
+			}
+
+			// does not block once the future is ready, e.g. in a continuation of it
+			typename detail::state<T>::reference get() const {
+				wait();
+				return s->get();
+			}
+
+			// calls f with this future once it is ready, inline on the thread completing it
+			template<typename F>
+			future<typename detail::unwrap<typename inncabs::detail::call_result<F, future<T>>::type>::type> then(F&& f) const {
+				using R = typename inncabs::detail::call_result<F, future<T>>::type;
+				using U = typename detail::unwrap<R>::type;
+				std::shared_ptr<detail::state<U>> next = std::make_shared<detail::state<U>>();
+				s->attach(detail::make_callback(detail::continuation_call<R, typename std::decay<F>::type, T>(next, std::forward<F>(f), *this)));
+				return future<U>(next);
+			}
+
+			// calls f with this future once it is ready, in a task spawned with launch policy l
+			template<typename F>
+			future<typename detail::unwrap<typename inncabs::detail::call_result<F, future<T>>::type>::type> then(const std::launch l, F&& f) const {
+				using R = typename inncabs::detail::call_result<F, future<T>>::type;
+				using U = typename detail::unwrap<R>::type;
+				using Call = detail::continuation_call<R, typename std::decay<F>::type, T>;
+				std::shared_ptr<detail::state<U>> next = std::make_shared<detail::state<U>>();
+				s->attach(detail::make_callback(detail::scheduled_call<Call>(l, Call(next, std::forward<F>(f), *this))));
+				return future<U>(next);
+			}
+
+			const std::shared_ptr<detail::state<T>>& shared_state() const { return s; }
+
+		private:
+			std::shared_ptr<detail::state<T>> s;
+		};
+
+		inline future<void> make_ready_future() {
+			std::shared_ptr<detail::state<void>> s = std::make_shared<detail::state<void>>();
+			s->complete();
+			return future<void>(s);
+		}
+
+		template<typename T>
+		future<typename std::decay<T>::type> make_ready_future(T&& value) {
+			using V = typename std::decay<T>::type;
+			std::shared_ptr<detail::state<V>> s = std::make_shared<detail::state<V>>();
+			s->store(V(std::forward<T>(value)));
+			s->complete();
+			return future<V>(s);
+		}
+
+		// spawns f like inncabs::async, but returns a continuation-style future
+		template<class Function, class... Args>
+		future<typename detail::unwrap<typename inncabs::detail::call_result<Function, Args...>::type>::type> async(const std::launch l, Function&& f, Args&&... args) {
+			using R = typename inncabs::detail::call_result<Function, Args...>::type;
+			using T = typename detail::unwrap<R>::type;
+			std::shared_ptr<detail::state<T>> s = std::make_shared<detail::state<T>>();
+			detail::schedule(l, detail::spawned_call<R, typename std::decay<Function>::type, typename std::decay<Args>::type...>(
+				s, std::forward<Function>(f), std::forward<Args>(args)...));
+			return future<T>(s);
+		}
+
+		// ready once all given futures are, failed with the first error of any of them
+		// their values are read with get(), which does not block anymore at that point
+		template<typename... T>
+		future<void> when_all(const future<T>&... fs) {
+			std::shared_ptr<detail::state<void>> s = std::make_shared<detail::state<void>>();
+			if(sizeof...(T) == 0) {
+				s->complete();
+				return future<void>(s);
+			}
+			detail::join_all(std::make_shared<detail::join_state>(sizeof...(T), s), fs...);
+			return future<void>(s);
+		}
+
+		template<typename T>
+		future<void> when_all(const std::vector<future<T>>& fs) {
+			std::shared_ptr<detail::state<void>> s = std::make_shared<detail::state<void>>();
+			if(fs.empty()) {
+				s->complete();
+				return future<void>(s);
+			}
+			std::shared_ptr<detail::join_state> j = std::make_shared<detail::join_state>(fs.size(), s);
+			for(const auto& f : fs) {
+				detail::join_arrival arrival = { j, f.shared_state() };
+				f.shared_state()->attach(detail::make_callback(std::move(arrival)));
+			}
+			return future<void>(s);
+		}
+	}
+}
@@ -0,0 +1,265 @@
+#pragma once
+
+/*
+ * Coroutine tasks for the coroutine launch type
+ *
+ * With std::async, every level of a recursive task graph which waits for its children holds a thread
+ * and its stack. A coro::task<T> is a C++20 coroutine instead, which suspends while it waits: its frame
+ * is all that is kept alive, and the worker moves on to other work. Tasks are lazy. co_await on a task
+ * which has not been started runs it inline, by symmetric transfer, and the awaiting coroutine is
+ * resumed by symmetric transfer once it has finished, so that chains of nested tasks take no stack
+ * space. coro::spawn starts a task on a worker of the current executor, where it runs in parallel
+ * until it is awaited. Whichever comes last of its completion and the co_await resumes the awaiting
+ * coroutine, without any locks. coro::run starts the root task of a computation and blocks the calling
+ * thread until it has finished.
+ *
+ * The coroutine launch type runs coroutines on a work-stealing pool of its own. Benchmarks implementing
+ * it call coro::declare_variant() before run_all; the launch type is skipped for all others. It is only
+ * available when compiling with coroutine support, i.e. C++20, which defines INNCABS_COROUTINES. Task
+ * statistics and traces only cover tasks spawned through inncabs::async.
+ */
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define INNCABS_COROUTINES 1
+#endif
+#endif
+
+#ifdef INNCABS_COROUTINES
+
+#include <coroutine>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <iostream>
+#include <cstdlib>
+
+#include "platform.h"
+#include "executor.h"
+
+namespace inncabs {
+	namespace coro {
+		template<typename T>
+		class task;
+
+		// marks the calling thread's next run_all invocation as implementing the coroutine launch type
+		inline bool& variant_declared() {
+			static INNCABS_THREAD_LOCAL bool declared = false;
+			return declared;
+		}
+
+		inline void declare_variant() {
+			variant_declared() = true;
+		}
+
+		namespace detail {
+			// resumes a coroutine on a worker of the current executor, embedded in the promise of its coroutine
+			class resumption : public inncabs::detail::task_base {
+			public:
+				void execute() override { handle.resume(); }
+				std::coroutine_handle<> handle;
+			};
+
+			inline void schedule(resumption& r, std::coroutine_handle<> h) {
+				executor* e = inncabs::detail::current_executor();
+				if(!e) {
+					std::cerr << "inncabs::coro: no executor installed for the coroutine launch type" << std::endl;
+					exit(-1);
+				}
+				r.handle = h;
+				e->submit(&r);
+			}
+
+			class promise_base {
+			public:
+				struct final_awaiter {
+					bool await_ready() noexcept { return false; }
+					template<typename Promise>
+					std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+						promise_base& p = h.promise();
+						if(p.joined.exchange(true, std::memory_order_acq_rel)) return p.continuation;
+						return std::noop_coroutine();
+					}
+					void await_resume() noexcept {}
+				};
+
+				std::suspend_always initial_suspend() noexcept { return {}; }
+				final_awaiter final_suspend() noexcept { return {}; }
+				void unhandled_exception() { error = std::current_exception(); }
+
+				std::coroutine_handle<> continuation;
+				// set by the first of the completion and the co_await, the second one resumes the awaiting coroutine
+				std::atomic<bool> joined { false };
+				std::exception_ptr error;
+				resumption start;
+			};
+
+			template<typename T>
+			class promise : public promise_base {
+			public:
+				task<T> get_return_object() noexcept;
+				template<typename V>
+				void return_value(V&& v) { value.emplace(std::forward<V>(v)); }
+				T result() {
+					if(error) std::rethrow_exception(error);
+					return std::move(*value);
+				}
+			private:
+				std::optional<T> value;
+			};
+
+			template<>
+			class promise<void> : public promise_base {
+			public:
+				task<void> get_return_object() noexcept;
+				void return_void() noexcept {}
+				void result() {
+					if(error) std::rethrow_exception(error);
+				}
+			};
+
+			// completes a task, without taking its result
+			template<typename T>
+			class join_awaiter {
+			public:
+				explicit join_awaiter(task<T>& t) : t(t) {}
+				bool await_ready() noexcept {
+					return t.started && t.handle.promise().joined.load(std::memory_order_acquire);
+				}
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+					promise<T>& p = t.handle.promise();
+					p.continuation = awaiting;
+					if(!t.started) {
+						t.started = true;
+						p.joined.store(true, std::memory_order_relaxed);
+						return t.handle;
+					}
+					if(p.joined.exchange(true, std::memory_order_acq_rel)) return awaiting;
+					return std::noop_coroutine();
+				}
+				void await_resume() noexcept {}
+			protected:
+				task<T>& t;
+			};
+
+			template<typename T>
+			class result_awaiter : public join_awaiter<T> {
+			public:
+				using join_awaiter<T>::join_awaiter;
+				T await_resume() { return this->t.handle.promise().result(); }
+			};
+
+			// signals a blocked thread
+			class latch {
+			public:
+				void signal() {
+					std::lock_guard<std::mutex> lock(mutex);
+					done = true;
+					cv.notify_all();
+				}
+				void wait() {
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [this] { return done; });
+				}
+			private:
+				std::mutex mutex;
+				std::condition_variable cv;
+				bool done = false;
+			};
+
+			// eager coroutine freeing its own frame, used to wait for a root task from a blocked thread
+			struct detached {
+				struct promise_type {
+					detached get_return_object() noexcept { return {}; }
+					std::suspend_never initial_suspend() noexcept { return {}; }
+					std::suspend_never final_suspend() noexcept { return {}; }
+					void return_void() noexcept {}
+					void unhandled_exception() noexcept { std::terminate(); }
+				};
+			};
+
+			template<typename T>
+			detached signal_completion(task<T>& t, latch& done) {
+				co_await join_awaiter<T>(t);
+				done.signal();
+			}
+		}
+
+		// lazily started coroutine returning a T, which has to be awaited before it is destroyed once started
+		template<typename T>
+		class task {
+		public:
+			using promise_type = detail::promise<T>;
+
+			task() noexcept : started(false) {}
+			task(task&& other) noexcept : handle(std::exchange(other.handle, nullptr)), started(other.started) {}
+			task& operator=(task&& other) noexcept {
+				if(this != &other) {
+					if(handle) handle.destroy();
+					handle = std::exchange(other.handle, nullptr);
+					started = other.started;
+				}
+				return *this;
+			}
+			~task() {
+				if(handle) handle.destroy();
+			}
+
+			detail::result_awaiter<T> operator co_await() noexcept { return detail::result_awaiter<T>(*this); }
+
+			// starts the task on a worker of the current executor
+			void start() {
+				started = true;
+				detail::schedule(handle.promise().start, handle);
+			}
+
+			// result of a finished task
+			T result() { return handle.promise().result(); }
+
+		private:
+			friend class detail::promise<T>;
+			friend class detail::join_awaiter<T>;
+			friend class detail::result_awaiter<T>;
+
+			explicit task(std::coroutine_handle<promise_type> h) noexcept : handle(h), started(false) {}
+			task(const task&) = delete;
+			task& operator=(const task&) = delete;
+
+			std::coroutine_handle<promise_type> handle;
+			bool started;
+		};
+
+		namespace detail {
+			template<typename T>
+			task<T> promise<T>::get_return_object() noexcept {
+				return task<T>(std::coroutine_handle<promise<T>>::from_promise(*this));
+			}
+
+			inline task<void> promise<void>::get_return_object() noexcept {
+				return task<void>(std::coroutine_handle<promise<void>>::from_promise(*this));
+			}
+		}
+
+		// starts t in parallel to the calling coroutine, which has to co_await the returned task
+		template<typename T>
+		task<T> spawn(task<T>&& t) {
+			t.start();
+			return std::move(t);
+		}
+
+		// runs t as the root of a computation on the current executor, blocks the calling thread until it has finished
+		template<typename T>
+		T run(task<T> t) {
+			detail::latch done;
+			t.start();
+			detail::signal_completion(t, done);
+			done.wait();
+			return t.result();
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,437 @@
+#pragma once
+
+/*
+ * Task executors for inncabs::async
+ *
+ * The benchmarks are written against std::launch policies. The standard policies (deferred, async and
+ * deferred|async) are forwarded to std::async unchanged. Additional policy bits select one of the
+ * executors implemented here, which run the very same task graphs on a pool of worker threads:
+ *
+ *   pool     - fixed number of workers sharing a single queue
+ *   stealing - one deque per worker, LIFO for the owner and FIFO for thieves (see work_stealing.h)
+ *   adaptive - the stealing pool, but a worker runs a task inline instead of spawning it while its own
+ *              deque already holds enough tasks for thieves (lazy binary splitting)
+ *   coroutine - a stealing pool running the coroutine variants of the benchmarks (see coroutine.h)
+ *
+ * By default the pools size themselves to the cores available to the process, so "taskset" and
+ * "/AFFINITY" restrictions are respected. When a core list is given, worker i is pinned to core
+ * i modulo the list length. Worker threads which wait on a future keep executing queued tasks until
+ * the awaited one has finished, which keeps nested waits deadlock-free.
+ */
+
+#include <future>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <string>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+#include "platform.h"
+#include "instrumentation.h"
+#include "tracing.h"
+
+namespace inncabs {
+
+	namespace launch {
+		const std::launch deferred = std::launch::deferred;
+		const std::launch async = std::launch::async;
+		const std::launch optional = std::launch::deferred | std::launch::async;
+		const std::launch pool = static_cast<std::launch>(0x100);
+		const std::launch stealing = static_cast<std::launch>(0x200);
+		const std::launch adaptive = static_cast<std::launch>(0x400);
+		const std::launch coroutine = static_cast<std::launch>(0x800);
+	}
+
+	inline bool is_executor_launch(const std::launch l) {
+		return (static_cast<int>(l) & ~static_cast<int>(launch::optional)) != 0;
+	}
+
+	namespace detail {
+		template<std::size_t... I>
+		struct index_sequence {};
+		template<std::size_t N, std::size_t... I>
+		struct make_index_sequence : make_index_sequence<N - 1, N - 1, I...> {};
+		template<std::size_t... I>
+		struct make_index_sequence<0, I...> : index_sequence<I...> {};
+
+		template<typename Function, typename... Args>
+		struct call_result {
+			using type = decltype(std::declval<typename std::decay<Function>::type&>()(std::declval<typename std::decay<Args>::type>()...));
+		};
+
+		class task_base {
+		public:
+			task_base() : finished(false) {}
+			virtual ~task_base() {}
+			virtual void execute() = 0;
+			bool done() const { return finished.load(std::memory_order_acquire); }
+		protected:
+			// must be the last access to the task by the executing thread, the owner may free it right after
+			void mark_done() { finished.store(true, std::memory_order_release); }
+		private:
+			std::atomic<bool> finished;
+		};
+
+		template<typename R>
+		class task_result : public task_base {
+		public:
+			task_result() : has_value(false) {}
+			~task_result() {
+				if(has_value) reinterpret_cast<R*>(&storage)->~R();
+			}
+			R get() {
+				if(error) std::rethrow_exception(error);
+				return std::move(*reinterpret_cast<R*>(&storage));
+			}
+		protected:
+			template<typename Call>
+			void run(Call&& call) {
+				try {
+					new (&storage) R(call());
+					has_value = true;
+				}
+				catch(...) {
+					error = std::current_exception();
+				}
+				mark_done();
+			}
+		private:
+			typename std::aligned_storage<sizeof(R), std::alignment_of<R>::value>::type storage;
+			bool has_value;
+			std::exception_ptr error;
+		};
+
+		template<>
+		class task_result<void> : public task_base {
+		public:
+			void get() {
+				if(error) std::rethrow_exception(error);
+			}
+		protected:
+			template<typename Call>
+			void run(Call&& call) {
+				try {
+					call();
+				}
+				catch(...) {
+					error = std::current_exception();
+				}
+				mark_done();
+			}
+		private:
+			std::exception_ptr error;
+		};
+
+		// stores decayed copies of the function and its arguments, like std::async does
+		template<typename R, typename Function, typename... Args>
+		class task : public task_result<R> {
+		public:
+			template<typename F, typename... A>
+			explicit task(F&& f, A&&... a) : fun(std::forward<F>(f)), args(std::forward<A>(a)...) {}
+			void execute() override {
+				this->run([this]() { return invoke(make_index_sequence<sizeof...(Args)>()); });
+			}
+		private:
+			template<std::size_t... I>
+			R invoke(index_sequence<I...>) {
+				return fun(std::move(std::get<I>(args))...);
+			}
+			Function fun;
+			std::tuple<Args...> args;
+		};
+	}
+
+	// calls of inncabs::async seen by an executor, and how many of them it ran inline instead of spawning a task
+	struct GranularityStats {
+		unsigned long long calls;
+		unsigned long long inlined;
+	};
+
+	class executor {
+	public:
+		virtual ~executor() {}
+		virtual std::string name() const = 0;
+		virtual unsigned concurrency() const = 0;
+		// schedules t for execution, ownership of t remains with the caller
+		virtual void submit(detail::task_base* t) = 0;
+		// returns once t has finished executing
+		virtual void wait(detail::task_base* t) = 0;
+		// decisions of executors choosing between spawning and inline execution, since the last reset
+		virtual GranularityStats granularity() const { GranularityStats none = { 0, 0 }; return none; }
+		virtual void reset_granularity() {}
+	};
+
+	namespace detail {
+		// atomic, as the tenants of a mix use the executor installed by one of them
+		inline std::atomic<executor*>& current_executor() {
+			static std::atomic<executor*> current(nullptr);
+			return current;
+		}
+	}
+
+	// installs an executor for the custom launch policies for the lifetime of the scope
+	class executor_scope {
+	public:
+		explicit executor_scope(executor* e) : previous(detail::current_executor()) { detail::current_executor() = e; }
+		~executor_scope() { detail::current_executor() = previous; }
+	private:
+		executor_scope(const executor_scope&);
+		executor_scope& operator=(const executor_scope&);
+		executor* previous;
+	};
+
+	// future returned by inncabs::async, wraps either a std::future or a task owned by an executor
+	// like a std::future obtained from std::async, it blocks on destruction until its task has finished
+	template<typename T>
+	class future {
+	public:
+		future() : exec(nullptr) {}
+		future(std::future<T>&& f) : std_future(std::move(f)), exec(nullptr) {}
+		future(executor* e, std::unique_ptr<detail::task_result<T>>&& t) : exec(e), task(std::move(t)) {}
+		future(future&& other) : std_future(std::move(other.std_future)), exec(other.exec), task(std::move(other.task)) {}
+		future& operator=(future&& other) {
+			if(this != &other) {
+				release();
+				std_future = std::move(other.std_future);
+				exec = other.exec;
+				task = std::move(other.task);
+			}
+			return *this;
+		}
+		~future() { release(); }
+
+		bool valid() const { return task || std_future.valid(); }
+
+		void wait() {
+			tracing::wait_scope traced;
+			if(task) exec->wait(task.get());
+			else std_future.wait();
+		}
+
+		T get() {
+			wait();
+			if(!task) return std_future.get();
+			std::unique_ptr<detail::task_result<T>> t(std::move(task));
+			return t->get();
+		}
+
+	private:
+		future(const future&);
+		future& operator=(const future&);
+
+		void release() {
+			if(task) {
+				tracing::wait_scope traced;
+				exec->wait(task.get());
+				task.reset();
+			}
+		}
+
+		std::future<T> std_future;
+		executor* exec;
+		std::unique_ptr<detail::task_result<T>> task;
+	};
+
+	namespace detail {
+		template<class Function, class... Args>
+		future<typename call_result<Function, Args...>::type> spawn(const std::launch policy, Function&& f, Args&&... args) {
+			using R = typename call_result<Function, Args...>::type;
+			if(!is_executor_launch(policy)) return std::async(policy, std::forward<Function>(f), std::forward<Args>(args)...);
+			executor* e = current_executor();
+			if(!e) {
+				std::cerr << "inncabs::async: no executor installed for launch policy " << static_cast<int>(policy) << std::endl;
+				exit(-1);
+			}
+			std::unique_ptr<task_result<R>> t(
+				new task<R, typename std::decay<Function>::type, typename std::decay<Args>::type...>(std::forward<Function>(f), std::forward<Args>(args)...));
+			e->submit(t.get());
+			return future<R>(e, std::move(t));
+		}
+	}
+
+	template<class Function, class... Args>
+	future<typename detail::call_result<Function, Args...>::type> async(const std::launch policy, Function&& f, Args&&... args) {
+		if(tracing::enabled()) {
+			if(instrumentation::enabled()) return detail::spawn(policy, tracing::wrap(instrumentation::wrap(std::forward<Function>(f))), std::forward<Args>(args)...);
+			return detail::spawn(policy, tracing::wrap(std::forward<Function>(f)), std::forward<Args>(args)...);
+		}
+		if(instrumentation::enabled()) return detail::spawn(policy, instrumentation::wrap(std::forward<Function>(f)), std::forward<Args>(args)...);
+		return detail::spawn(policy, std::forward<Function>(f), std::forward<Args>(args)...);
+	}
+
+	// common infrastructure of the thread pools: worker management, idling, and helping waits
+	class thread_pool : public executor {
+	public:
+		unsigned concurrency() const override { return static_cast<unsigned>(workers.size()); }
+
+		void submit(detail::task_base* t) override {
+			push(t);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(sleeping.load() > 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				wakeup.notify_one();
+			}
+		}
+
+		void wait(detail::task_base* t) override {
+			if(t->done()) return;
+			if(current_pool() == this) {
+				// help: keep executing other tasks until the awaited one has finished
+				const unsigned id = worker_index();
+				while(!t->done()) {
+					detail::task_base* other = pop(id, true);
+					if(other) run_task(other);
+					else std::this_thread::yield();
+				}
+			}
+			else {
+				std::unique_lock<std::mutex> lock(mutex);
+				external_waiters.fetch_add(1);
+				completion.wait(lock, [t] { return t->done(); });
+				external_waiters.fetch_sub(1);
+			}
+		}
+
+	protected:
+		thread_pool() : shutdown(false), sleeping(0), external_waiters(0) {}
+
+		// the derived constructor has to call start once its queues are set up, and its destructor stop
+		void start(unsigned num_workers, const std::vector<unsigned>& cpus) {
+			pinning = cpus;
+			for(unsigned i = 0; i < num_workers; ++i) {
+				workers.emplace_back(&thread_pool::worker_loop, this, i);
+			}
+		}
+
+		void stop() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				shutdown.store(true);
+				wakeup.notify_all();
+			}
+			for(auto& w : workers) w.join();
+			workers.clear();
+		}
+
+		// enqueue a task, called from worker threads of this pool as well as from external threads
+		virtual void push(detail::task_base* t) = 0;
+		// dequeue a task for worker id, or return nullptr; helping is set while the worker waits on a future
+		virtual detail::task_base* pop(unsigned id, bool helping) = 0;
+		// whether any task might be queued, used to decide whether an idle worker may go to sleep
+		virtual bool has_work() const = 0;
+
+		static thread_pool*& current_pool() {
+			static INNCABS_THREAD_LOCAL thread_pool* pool = nullptr;
+			return pool;
+		}
+		static unsigned& worker_index() {
+			static INNCABS_THREAD_LOCAL unsigned index = 0;
+			return index;
+		}
+
+		// number of workers which have run out of work and gone to sleep
+		unsigned idle_workers() const {
+			return sleeping.load(std::memory_order_relaxed);
+		}
+
+	private:
+		void run_task(detail::task_base* t) {
+			t->execute();
+			// t may already be gone at this point, only the pool state is accessed
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(external_waiters.load() > 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				completion.notify_all();
+			}
+		}
+
+		void worker_loop(unsigned id) {
+			current_pool() = this;
+			worker_index() = id;
+			if(!pinning.empty()) set_thread_affinity(std::vector<unsigned>(1, pinning[id % pinning.size()]));
+			const unsigned SPIN_LIMIT = 64;
+			unsigned idle = 0;
+			while(!shutdown.load()) {
+				detail::task_base* t = pop(id, false);
+				if(t) {
+					run_task(t);
+					idle = 0;
+				}
+				else if(++idle < SPIN_LIMIT) {
+					std::this_thread::yield();
+				}
+				else {
+					std::unique_lock<std::mutex> lock(mutex);
+					sleeping.fetch_add(1);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if(!has_work() && !shutdown.load()) wakeup.wait(lock);
+					sleeping.fetch_sub(1);
+					idle = 0;
+				}
+			}
+			current_pool() = nullptr;
+		}
+
+		std::vector<std::thread> workers;
+		std::vector<unsigned> pinning;
+		std::atomic<bool> shutdown;
+		std::atomic<unsigned> sleeping;
+		std::atomic<unsigned> external_waiters;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::condition_variable completion;
+	};
+
+	// fixed-size pool with one shared queue
+	class fixed_pool : public thread_pool {
+	public:
+		explicit fixed_pool(unsigned num_workers, const std::vector<unsigned>& cpus = std::vector<unsigned>()) : queued(0) { start(num_workers, cpus); }
+		~fixed_pool() { stop(); }
+
+		std::string name() const override { return "pool"; }
+
+	protected:
+		void push(detail::task_base* t) override {
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			queue.push_back(t);
+			queued.store(queue.size());
+		}
+
+		// idle workers take the oldest task, waiting workers the newest one: this keeps helping depth-first
+		// and bounds the stack depth of a waiting worker by the depth of the task tree
+		detail::task_base* pop(unsigned, bool helping) override {
+			if(queued.load(std::memory_order_relaxed) == 0) return nullptr;
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			if(queue.empty()) return nullptr;
+			detail::task_base* t;
+			if(helping) {
+				t = queue.back();
+				queue.pop_back();
+			}
+			else {
+				t = queue.front();
+				queue.pop_front();
+			}
+			queued.store(queue.size());
+			return t;
+		}
+
+		bool has_work() const override {
+			return queued.load() > 0;
+		}
+
+	private:
+		std::mutex queue_mutex;
+		std::deque<detail::task_base*> queue;
+		std::atomic<std::size_t> queued;
+	};
+}
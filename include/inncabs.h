@@ -5,6 +5,9 @@
 #include <future>
 #include <atomic>
 #include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
 #include <algorithm>
 #include <iostream>
 #include <sstream>
@@ -17,6 +20,21 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <map>
+
+#include "statistics.h"
+#include "instrumentation.h"
+#include "tracing.h"
+#include "perf_counters.h"
+#include "allocation.h"
+#include "json.h"
+#include "numa.h"
+#include "mix.h"
+#include "platform.h"
+#include "executor.h"
+#include "work_stealing.h"
+#include "coroutine.h"
+#include "thread_registry.h"
 
 namespace {
 	bool readEnvBool(const char* envName) {
@@ -26,176 +44,637 @@ namespace {
 		return std::any_of(trueSynonyms.cbegin(), trueSynonyms.cend(), [val](const std::string& str) { return str == val; });
 	}
 
-	template<typename T>
-	double mean(std::vector<T> vec) {
-		if(vec.size() == 1) return static_cast<double>(vec[0]);
-		double sum = 0.0;
-		for(const auto& e : vec) sum += e;
-		return sum / vec.size();
-	}
-
-	template<typename T>
-	T median(std::vector<T> vec) {
-		if(vec.size() == 1) return vec[0];
-		std::sort(vec.begin(), vec.end());
-		if(vec.size() % 2 == 0) {
-			return (vec[vec.size() / 2] + vec[vec.size() / 2 + 1]) / 2;
-		}
-		else {
-			return vec[vec.size() / 2];
+	std::vector<std::string> splitList(const std::string& list, char separator = ',') {
+		std::vector<std::string> ret;
+		std::stringstream ss(list);
+		std::string item;
+		while(std::getline(ss, item, separator)) {
+			if(!item.empty()) ret.push_back(item);
 		}
+		return ret;
 	}
 
-	template<typename T>
-	double stddev(std::vector<T> vec) {
-		if(vec.size() == 1) return 0.0;
-		double m = mean(vec);
-		double dsum = 0.0;
-		for(const auto& e : vec) dsum += abs(e-m);
-		return sqrt(dsum / vec.size());
-	}
 }
 
 namespace inncabs {
 	const static char* ENV_VAR_CSV = "INNCABS_CSV_OUTPUT";
 	const static char* ENV_VAR_MIN = "INNCABS_MIN_OUTPUT";
+	const static char* ENV_VAR_JSON = "INNCABS_JSON_OUTPUT";
 	const static char* ENV_VAR_REPEATS = "INNCABS_REPEATS";
 	const static char* ENV_VAR_LAUNCH = "INNCABS_LAUNCH_TYPES";
 	const static char* ENV_VAR_TIMEOUT = "INNCABS_TIMEOUT";
+	const static char* ENV_VAR_TASK_STATS = "INNCABS_TASK_STATS";
+	const static char* ENV_VAR_WARMUP = "INNCABS_WARMUP";
+	const static char* ENV_VAR_OUTLIERS = "INNCABS_REJECT_OUTLIERS";
+	const static char* ENV_VAR_PERF = "INNCABS_PERF_COUNTERS";
+	const static char* ENV_VAR_ALLOC = "INNCABS_ALLOC_STATS";
+	const static char* ENV_VAR_THREADS = "INNCABS_THREADS";
+	const static char* ENV_VAR_SPLIT_DEPTH = "INNCABS_SPLIT_DEPTH";
 
-	using BenchResult = std::tuple<bool, long long>;
+	// verified, time (ns), task statistics, performance counters, granularity, allocations and verification time (ns)
+	using BenchResult = std::tuple<bool, long long, TaskStats, PerfCounts, GranularityStats, AllocStats, long long>;
 	using LaunchConfiguration = std::tuple<std::launch, std::string>;
 
+	// work done by one run of a benchmark, reported as time per unit and throughput when declared
+	struct WorkUnits {
+		const char* unit;					// singular, e.g. "task", nullptr if not declared
+		double count;
+		double bytes;						// bytes processed by one run, 0 if not meaningful
+	};
+
+	// the work declared for the calling thread's next run_all invocation
+	inline WorkUnits& declared_work() {
+		static INNCABS_THREAD_LOCAL WorkUnits work = { nullptr, 0, 0 };
+		return work;
+	}
+
+	// declares the work of one run of the benchmark, before calling run_all
+	inline void declare_work(const char* unit, double count, double bytes = 0) {
+		WorkUnits w = { unit, count, bytes };
+		declared_work() = w;
+	}
+
+	// settings of a run_all invocation, read from the environment
+	struct RunSettings {
+		bool csvoutput;
+		bool minoutput;
+		bool jsonoutput;
+		bool taskstats;
+		bool perfcounters;
+		bool allocstats;
+		bool rejectOutliers;
+		unsigned repeats;
+		unsigned warmups;
+		std::vector<std::string> selectedConfigs;
+		std::vector<unsigned> threads;		// thread counts to sweep, empty if not sweeping
+		unsigned splitDepth;				// deque depth at which the adaptive launch type runs tasks inline
+		WorkUnits work;						// declared by the benchmark, see declare_work
+		std::chrono::milliseconds timeout;
+	};
+
+	// measurements of all repetitions of one launch configuration
+	struct ConfigResult {
+		std::string launch;
+		unsigned threads;
+		std::vector<bool> verified;
+		std::vector<double> times;			// ms
+		std::vector<double> warmupTimes;	// ms
+		std::vector<double> verifyTimes;	// ms, of every repetition, not part of times
+		statistics::Summary summary;
+		TaskStats taskStats;				// of the last repetition
+		PerfCounts perfCounts;				// mean over all repetitions
+		GranularityStats granularity;		// of the last repetition
+		std::vector<AllocStats> allocations;	// of every repetition
+
+		bool success() const {
+			return !verified.empty() && std::all_of(verified.cbegin(), verified.cend(), [](bool v) { return v; });
+		}
+	};
+
+	// receives the results of run_all instead of them being printed, used by the driver to compare runs
+	using result_sink = std::function<void(const std::string& bench, const std::vector<ConfigResult>& results)>;
+
+	inline result_sink& current_sink() {
+		static result_sink sink;
+		return sink;
+	}
+
+	inline RunSettings read_settings() {
+		RunSettings s;
+		s.csvoutput = readEnvBool(ENV_VAR_CSV);
+		s.minoutput = readEnvBool(ENV_VAR_MIN);
+		s.jsonoutput = readEnvBool(ENV_VAR_JSON);
+		s.taskstats = readEnvBool(ENV_VAR_TASK_STATS);
+		s.perfcounters = readEnvBool(ENV_VAR_PERF);
+		s.allocstats = readEnvBool(ENV_VAR_ALLOC);
+		s.rejectOutliers = readEnvBool(ENV_VAR_OUTLIERS);
+		std::string configSelection = "deferred,async,optional";
+		if(getenv(ENV_VAR_LAUNCH)) configSelection = getenv(ENV_VAR_LAUNCH);
+		s.selectedConfigs = splitList(configSelection);
+		s.repeats = 1;
+		if(getenv(ENV_VAR_REPEATS)) s.repeats = std::atol(getenv(ENV_VAR_REPEATS));
+		s.warmups = 0;
+		if(getenv(ENV_VAR_WARMUP)) s.warmups = std::atol(getenv(ENV_VAR_WARMUP));
+		if(getenv(ENV_VAR_THREADS)) {
+			for(const auto& count : splitList(getenv(ENV_VAR_THREADS))) {
+				long n = std::atol(count.c_str());
+				if(n > 0) s.threads.push_back(static_cast<unsigned>(n));
+			}
+		}
+		s.splitDepth = 1;
+		if(getenv(ENV_VAR_SPLIT_DEPTH)) s.splitDepth = std::max(1l, std::atol(getenv(ENV_VAR_SPLIT_DEPTH)));
+		s.timeout = std::chrono::milliseconds(0);
+		if(getenv(ENV_VAR_TIMEOUT)) s.timeout = std::chrono::milliseconds(std::atol(getenv(ENV_VAR_TIMEOUT)));
+		s.work = WorkUnits { nullptr, 0, 0 };
+		return s;
+	}
+
+	// creates the executor backing a custom launch policy, or nullptr for the std::async policies
+	// workers are pinned to the given cores, or left unpinned if the list is empty
+	inline std::unique_ptr<executor> make_executor(const std::launch l, unsigned threads, const std::vector<unsigned>& cpus, const RunSettings& s) {
+		if(l == launch::pool) return std::unique_ptr<executor>(new fixed_pool(threads, cpus));
+		if(l == launch::stealing) return std::unique_ptr<executor>(new stealing_pool(threads, cpus));
+		if(l == launch::adaptive) return std::unique_ptr<executor>(new stealing_pool(threads, cpus, s.splitDepth));
+		if(l == launch::coroutine) return std::unique_ptr<executor>(new stealing_pool(threads, cpus));
+		return std::unique_ptr<executor>();
+	}
+
+	// executor for the given configuration, shared by all run_all invocations of the process so that
+	// benchmarks run by the driver find its workers already started; never destroyed, as exit() may be
+	// called by the timeout while workers are still busy
+	inline executor* shared_executor(const std::launch l, unsigned threads, const std::vector<unsigned>& cpus, const RunSettings& s) {
+		using key = std::tuple<int, unsigned, std::vector<unsigned>, unsigned>;
+		static std::map<key, executor*>* executors = new std::map<key, executor*>();
+		static std::mutex* executors_mutex = new std::mutex();
+		std::lock_guard<std::mutex> lock(*executors_mutex);
+		key k(static_cast<int>(l), threads, cpus, l == launch::adaptive ? s.splitDepth : 0);
+		auto it = executors->find(k);
+		if(it != executors->end()) return it->second;
+		executor* e = make_executor(l, threads, cpus, s).release();
+		(*executors)[k] = e;
+		return e;
+	}
+
+	// whether the granularity decisions of the adaptive launch type are part of the output
+	inline bool reports_granularity(const RunSettings& s) {
+		return std::find(s.selectedConfigs.cbegin(), s.selectedConfigs.cend(), "adaptive") != s.selectedConfigs.cend();
+	}
+
+	// all launch types, in the order they are measured in
+	inline std::vector<LaunchConfiguration> launch_configurations() {
+		return std::vector<LaunchConfiguration> {
+			LaunchConfiguration { std::launch::deferred, "deferred" },
+			LaunchConfiguration { std::launch::deferred | std::launch::async, "optional" },
+			LaunchConfiguration { std::launch::async, "async" },
+			LaunchConfiguration { launch::pool, "pool" },
+			LaunchConfiguration { launch::stealing, "stealing" },
+			LaunchConfiguration { launch::adaptive, "adaptive" },
+#ifdef INNCABS_COROUTINES
+			LaunchConfiguration { launch::coroutine, "coroutine" },
+#endif
+		};
+	}
+
+	// cores used by n threads in a sweep: the first n allowed cores, wrapping around if there are fewer
+	inline std::vector<unsigned> sweep_placement(const std::vector<unsigned>& allowed, unsigned n) {
+		std::vector<unsigned> cpus;
+		if(allowed.empty()) return cpus;
+		for(unsigned i = 0; i < n; ++i) cpus.push_back(allowed[i % allowed.size()]);
+		return cpus;
+	}
+
 	template<typename Executor, typename Checker>
 	BenchResult benchmark(Executor x, Checker c, const std::launch l, const std::function<void()>& initializer) {
 		initializer();
-		std::chrono::high_resolution_clock highc;
-		auto start = highc.now();
+		instrumentation::reset();
+		// the executor of a mix is shared, and its granularity counters cannot be reset while other tenants run
+		executor* exec = mix::active() ? nullptr : detail::current_executor().load();
+		if(exec) exec->reset_granularity();
+		perf::session counters;
+		allocation::session allocs;
+		if(allocation::enabled()) allocs.start();
+		if(perf::enabled()) counters.start();
+		dataflow::thread_scope threads;
+		auto start = std::chrono::steady_clock::now();
 		auto r =  x(l);
-		auto end = highc.now();
-		return BenchResult(c(r), std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+		// threads of continuation-style futures may still run the epilogue of their functions
+		threads.join();
+		auto end = std::chrono::steady_clock::now();
+		PerfCounts perfCounts = counters.stop();
+		AllocStats allocStats = allocs.stop();
+		TaskStats stats = instrumentation::snapshot();
+		GranularityStats granularity = { 0, 0 };
+		if(exec) granularity = exec->granularity();
+		// verification is timed on its own, after all counters have been stopped
+		auto verifyStart = std::chrono::steady_clock::now();
+		const bool verified = c(r);
+		auto verifyEnd = std::chrono::steady_clock::now();
+		return BenchResult(verified, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), stats, perfCounts, granularity, allocStats,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(verifyEnd - verifyStart).count());
 	}
 
+	// time per unit of work and throughput of a run taking the given time
+	struct WorkRates {
+		double ns_per_unit;
+		double units_per_second;
+		double gb_per_second;
+	};
+
+	inline WorkRates work_rates(const WorkUnits& w, double ms) {
+		WorkRates r = { 0, 0, 0 };
+		if(!w.unit || w.count <= 0 || ms <= 0) return r;
+		r.ns_per_unit = ms * 1.0e6 / w.count;
+		r.units_per_second = w.count / (ms / 1000.0);
+		r.gb_per_second = w.bytes / (ms * 1.0e6);
+		return r;
+	}
+
+	inline void print_header(const RunSettings& s, const std::string& bench) {
+		if(s.jsonoutput || s.minoutput) return;
+		if(s.csvoutput) {
+			std::cout << std::setw(16) << bench << ", threads" << ", success" << ", time (ms)" << ", stddev"
+				<< ", p90 (ms)" << ", p99 (ms)" << ", ci95 low (ms)" << ", ci95 high (ms)" << ", outliers" << ", verify (ms)";
+			if(s.taskstats) std::cout << ", tasks" << ", inline" << ", remote" << ", peak threads" << ", avg task (us)";
+			if(reports_granularity(s)) std::cout << ", async calls" << ", cut-off inlined";
+			if(s.allocstats) std::cout << ", allocations" << ", frees" << ", allocated bytes" << ", peak rss (kB)";
+			if(s.perfcounters) {
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) std::cout << ", " << PERF_EVENT_NAMES[e];
+				std::cout << ", ipc";
+			}
+			if(s.work.unit) {
+				std::cout << ", ns per " << s.work.unit << ", " << s.work.unit << "s per s";
+				if(s.work.bytes > 0) std::cout << ", GB per s";
+			}
+			std::cout << std::endl;
+		}
+		else {
+			std::cout << "Benchmarking " << bench << std::endl;
+		}
+	}
+
+	inline void print_result(const RunSettings& s, const ConfigResult& res) {
+		const statistics::Summary& summary = res.summary;
+		const TaskStats& stats = res.taskStats;
+		const PerfCounts& perfCounts = res.perfCounts;
+		const AllocStats allocs = allocation::average(res.allocations);
+		const WorkRates rates = work_rates(s.work, summary.p50);
+		const double verifyTime = statistics::percentile(res.verifyTimes, 50.0);
+		if(s.jsonoutput) {
+			return;
+		} else if(s.minoutput) {
+			if(!s.threads.empty()) std::cout << res.threads << ",";
+			std::cout << summary.p50 << "," << summary.stddev << "," << verifyTime;
+			if(s.taskstats) {
+				std::cout << "," << stats.spawned << "," << stats.inlined << "," << stats.remote
+					<< "," << stats.peak_threads << "," << stats.avg_task_us;
+			}
+			if(reports_granularity(s)) std::cout << "," << res.granularity.calls << "," << res.granularity.inlined;
+			if(s.allocstats) std::cout << "," << allocs.allocations << "," << allocs.frees << "," << allocs.bytes << "," << allocs.peak_rss_kb;
+			if(s.perfcounters) {
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) std::cout << "," << perf::format(perfCounts, e);
+				std::cout << "," << perf::format_ipc(perfCounts);
+			}
+			if(s.work.unit) {
+				std::cout << "," << rates.ns_per_unit << "," << rates.units_per_second;
+				if(s.work.bytes > 0) std::cout << "," << rates.gb_per_second;
+			}
+			std::cout << std::endl;
+		} else if(s.csvoutput) {
+			std::cout << std::setw(16) << res.launch
+				<< std::setw(2) << ", " << std::setw(14) << res.threads
+				<< std::setw(2) << ", " << std::setw(14) << res.success()
+				<< std::setw(2) << ", " << std::setw(14) << summary.p50
+				<< std::setw(2) << ", " << std::setw(14) << summary.stddev
+				<< std::setw(2) << ", " << std::setw(14) << summary.p90
+				<< std::setw(2) << ", " << std::setw(14) << summary.p99
+				<< std::setw(2) << ", " << std::setw(14) << summary.ci95_low
+				<< std::setw(2) << ", " << std::setw(14) << summary.ci95_high
+				<< std::setw(2) << ", " << std::setw(14) << summary.outliers
+				<< std::setw(2) << ", " << std::setw(14) << verifyTime;
+			if(s.taskstats) {
+				std::cout << std::setw(2) << ", " << std::setw(14) << stats.spawned
+					<< std::setw(2) << ", " << std::setw(14) << stats.inlined
+					<< std::setw(2) << ", " << std::setw(14) << stats.remote
+					<< std::setw(2) << ", " << std::setw(14) << stats.peak_threads
+					<< std::setw(2) << ", " << std::setw(14) << stats.avg_task_us;
+			}
+			if(reports_granularity(s)) {
+				std::cout << std::setw(2) << ", " << std::setw(14) << res.granularity.calls
+					<< std::setw(2) << ", " << std::setw(14) << res.granularity.inlined;
+			}
+			if(s.allocstats) {
+				std::cout << std::setw(2) << ", " << std::setw(14) << allocs.allocations
+					<< std::setw(2) << ", " << std::setw(14) << allocs.frees
+					<< std::setw(2) << ", " << std::setw(14) << allocs.bytes
+					<< std::setw(2) << ", " << std::setw(14) << allocs.peak_rss_kb;
+			}
+			if(s.perfcounters) {
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) std::cout << std::setw(2) << ", " << std::setw(14) << perf::format(perfCounts, e);
+				std::cout << std::setw(2) << ", " << std::setw(14) << perf::format_ipc(perfCounts);
+			}
+			if(s.work.unit) {
+				std::cout << std::setw(2) << ", " << std::setw(14) << rates.ns_per_unit
+					<< std::setw(2) << ", " << std::setw(14) << rates.units_per_second;
+				if(s.work.bytes > 0) std::cout << std::setw(2) << ", " << std::setw(14) << rates.gb_per_second;
+			}
+			std::cout << std::endl;
+		}
+		else {
+			std::cout << "launch: " << res.launch << std::endl
+				<< "threads: " << res.threads << std::endl
+				<< "success: " << (res.success() ? "SUCCESSFUL" : "FAILED") << std::endl
+				<< "time: " << summary.p50 << " ms" << std::endl
+				<< "stddev: " << summary.stddev << std::endl
+				<< "p90 / p99: " << summary.p90 << " / " << summary.p99 << " ms" << std::endl
+				<< "95% confidence interval of mean: [" << summary.ci95_low << ", " << summary.ci95_high << "] ms" << std::endl;
+			if(s.rejectOutliers) std::cout << "outliers rejected: " << summary.outliers << std::endl;
+			std::cout << "verification: " << verifyTime << " ms (not timed)" << std::endl;
+			if(s.taskstats) {
+				std::cout << "tasks: " << stats.spawned << " (" << stats.inlined << " inline, " << stats.remote << " remote)" << std::endl
+					<< "peak threads: " << stats.peak_threads << std::endl
+					<< "avg task: " << stats.avg_task_us << " us" << std::endl;
+			}
+			if(res.granularity.calls > 0) {
+				std::cout << "cut-off: " << res.granularity.inlined << " of " << res.granularity.calls << " async calls inlined" << std::endl;
+			}
+			if(s.allocstats) {
+				std::cout << "allocations: " << allocs.allocations << " (" << allocs.bytes << " bytes, " << allocs.frees << " frees)" << std::endl
+					<< "peak rss: " << allocs.peak_rss_kb << " kB" << std::endl;
+			}
+			if(s.perfcounters) {
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) std::cout << PERF_EVENT_NAMES[e] << ": " << perf::format(perfCounts, e) << std::endl;
+				std::cout << "ipc: " << perf::format_ipc(perfCounts) << std::endl;
+			}
+			if(s.work.unit) {
+				std::cout << "per " << s.work.unit << ": " << rates.ns_per_unit << " ns (" << rates.units_per_second << " " << s.work.unit << "s/s)" << std::endl;
+				if(s.work.bytes > 0) std::cout << "bandwidth: " << rates.gb_per_second << " GB/s" << std::endl;
+			}
+		}
+	}
+
+	// the environment results were obtained in
+	inline void write_environment(json::writer& w) {
+		w.key("environment").begin_object();
+		w.field("host", host_name());
+		w.field("compiler", compiler_version());
+		w.field("standard_library", standard_library());
+		w.field("hardware_concurrency", std::thread::hardware_concurrency());
+		w.field("cores", available_cores());
+		w.field("affinity", affinity_cpus());
+		w.field("timestamp", static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()));
+		w.end_object();
+	}
+
+	// complete results of a run_all invocation, including the environment they were obtained in
+	inline void print_json(const RunSettings& s, const std::string& bench, const std::vector<ConfigResult>& results) {
+		json::writer w(std::cout);
+		w.begin_object();
+		w.field("benchmark", bench);
+		w.field("arguments", command_line());
+		write_environment(w);
+
+		w.key("settings").begin_object();
+		w.field("repeats", s.repeats);
+		w.field("warmup", s.warmups);
+		w.field("reject_outliers", s.rejectOutliers);
+		w.field("task_stats", s.taskstats);
+		w.field("perf_counters", s.perfcounters);
+		w.field("alloc_stats", s.allocstats);
+		w.field("threads", s.threads);
+		w.field("pinned", !s.threads.empty());
+		w.field("numa", numa::policy_name());
+		w.field("split_depth", s.splitDepth);
+		w.end_object();
+
+		w.key("results").begin_array();
+		for(const auto& res : results) {
+			w.begin_object();
+			w.field("launch", res.launch);
+			w.field("threads", res.threads);
+			w.field("success", res.success());
+			w.field("verified", res.verified);
+			w.field("times_ms", res.times);
+			w.field("warmup_times_ms", res.warmupTimes);
+			w.field("verify_times_ms", res.verifyTimes);
+			w.key("summary").begin_object();
+			w.field("samples", res.summary.samples);
+			w.field("outliers", res.summary.outliers);
+			w.field("median_ms", res.summary.p50);
+			w.field("mean_ms", res.summary.mean);
+			w.field("stddev_ms", res.summary.stddev);
+			w.field("min_ms", res.summary.min);
+			w.field("max_ms", res.summary.max);
+			w.field("p90_ms", res.summary.p90);
+			w.field("p99_ms", res.summary.p99);
+			w.field("ci95_low_ms", res.summary.ci95_low);
+			w.field("ci95_high_ms", res.summary.ci95_high);
+			w.end_object();
+			if(s.taskstats) {
+				w.key("task_stats").begin_object();
+				w.field("spawned", res.taskStats.spawned);
+				w.field("inline", res.taskStats.inlined);
+				w.field("remote", res.taskStats.remote);
+				w.field("peak_threads", res.taskStats.peak_threads);
+				w.field("avg_task_us", res.taskStats.avg_task_us);
+				w.end_object();
+			}
+			if(s.work.unit) {
+				// rates of the median time
+				const WorkRates rates = work_rates(s.work, res.summary.p50);
+				w.key("work").begin_object();
+				w.field("unit", s.work.unit);
+				w.field("count", s.work.count);
+				w.field("ns_per_unit", rates.ns_per_unit);
+				w.field("units_per_second", rates.units_per_second);
+				if(s.work.bytes > 0) {
+					w.field("bytes", s.work.bytes);
+					w.field("gb_per_second", rates.gb_per_second);
+				}
+				w.end_object();
+			}
+			if(res.granularity.calls > 0) {
+				w.key("granularity").begin_object();
+				w.field("async_calls", res.granularity.calls);
+				w.field("inlined", res.granularity.inlined);
+				w.end_object();
+			}
+			if(s.allocstats) {
+				w.key("allocations").begin_array();
+				for(const auto& a : res.allocations) {
+					w.begin_object();
+					w.field("allocations", a.allocations);
+					w.field("frees", a.frees);
+					w.field("bytes", a.bytes);
+					w.field("peak_rss_kb", a.peak_rss_kb);
+					w.end_object();
+				}
+				w.end_array();
+			}
+			if(s.perfcounters) {
+				w.key("perf_counters").begin_object();
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) {
+					std::string name = PERF_EVENT_NAMES[e];
+					std::replace(name.begin(), name.end(), ' ', '_');
+					w.key(name);
+					if(res.perfCounts.valid[e]) w.value(res.perfCounts.values[e]);
+					else w.null();
+				}
+				w.end_object();
+			}
+			w.end_object();
+		}
+		w.end_array();
+		w.end_object();
+	}
+
+	// installs the executor of a launch configuration for the lifetime of the scope
+	// the tenants of a mix share it: the last tenant to arrive installs it for all of them, and the last one
+	// to leave restores the previous executor once no tenant uses it anymore
+	class config_executor_scope {
+	public:
+		config_executor_scope(executor* e, bool tenant) : tenant(tenant), previous(nullptr) {
+			if(tenant) mix::synchronize([e] { tenant_previous() = detail::current_executor().exchange(e); });
+			else previous = detail::current_executor().exchange(e);
+		}
+		~config_executor_scope() {
+			if(tenant) mix::synchronize([] { detail::current_executor() = tenant_previous(); });
+			else detail::current_executor() = previous;
+		}
+	private:
+		config_executor_scope(const config_executor_scope&);
+		config_executor_scope& operator=(const config_executor_scope&);
+		static executor*& tenant_previous() {
+			static executor* e = nullptr;
+			return e;
+		}
+		bool tenant;
+		executor* previous;
+	};
+
 	template<typename Executor, typename Checker>
 	void run_all(Executor x, Checker c, const std::string& bench, const std::function<void()>& initializer = [](){}) {
 		// read environment variables
-		bool csvoutput = readEnvBool(ENV_VAR_CSV);
-		bool minoutput = readEnvBool(ENV_VAR_MIN);
-		std::string configSelection = "deferred,async,optional";
-		if(getenv(ENV_VAR_LAUNCH)) configSelection = getenv(ENV_VAR_LAUNCH);
-		unsigned repeats = 1;
-		if(getenv(ENV_VAR_REPEATS)) repeats = std::atol(getenv(ENV_VAR_REPEATS));
-		std::chrono::milliseconds timeout{ 0 };
-		if(getenv(ENV_VAR_TIMEOUT)) timeout = std::chrono::milliseconds(std::atol(getenv(ENV_VAR_TIMEOUT)));
-
-		// start timeout if requested
-		bool done = false;
-		if(timeout != std::chrono::milliseconds(0)) {
-			auto t = std::thread([&] {
+		RunSettings settings = read_settings();
+		settings.work = declared_work();
+		declared_work() = WorkUnits { nullptr, 0, 0 };
+		bool coroutines = false;
+#ifdef INNCABS_COROUTINES
+		coroutines = coro::variant_declared();
+		coro::variant_declared() = false;
+#endif
+		// the counters of these are process-wide, and cannot be attributed to one of several concurrent tenants
+		const bool tenant = mix::active();
+		if(tenant) settings.taskstats = settings.perfcounters = settings.allocstats = false;
+		const bool printing = !current_sink();
+		instrumentation::enable(settings.taskstats);
+		perf::enable(settings.perfcounters);
+		allocation::enable(settings.allocstats);
+		// the driver configures tracing for all tenants of a mix before starting them
+		if(!tenant) tracing::configure();
+
+		// start timeout if requested, the flag outlives this call as the driver may run further benchmarks
+		std::shared_ptr<std::atomic<bool>> done = std::make_shared<std::atomic<bool>>(false);
+		if(settings.timeout != std::chrono::milliseconds(0)) {
+			auto timeout = settings.timeout;
+			auto t = std::thread([done, timeout] {
 				std::this_thread::sleep_for(timeout);
-				if(!done) exit(-1);
+				if(!done->load()) exit(-1);
 			});
 			t.detach();
 		}
 
 		// write header
-		if(csvoutput) {
-			std::cout << std::setw(16) << bench << ", success" << ", time (ms)" << ", stddev" << std::endl;
-		}
-		else if(!minoutput) {
-			std::cout << "Benchmarking " << bench << std::endl;
-		}
+		if(printing) print_header(settings, bench);
 
 		// perform benchmarks
-		std::vector<LaunchConfiguration> configurations {
-			LaunchConfiguration { std::launch::deferred, "deferred" },
-			LaunchConfiguration { std::launch::deferred | std::launch::async, "optional" },
-			LaunchConfiguration { std::launch::async, "async" } };
+		const std::vector<LaunchConfiguration> configurations = launch_configurations();
+
+		// without a sweep, every configuration runs once with as many threads as there are cores available
+		// with a sweep, the main thread (and thereby every thread std::async creates) is restricted to the
+		// cores of the current thread count, and pool workers are pinned to one core each
+		const bool sweep = !settings.threads.empty();
+		const std::vector<unsigned> allowedCpus = affinity_cpus();
+		std::vector<unsigned> threadCounts = settings.threads;
+		if(!sweep) threadCounts.push_back(available_cores());
 
+		std::vector<ConfigResult> results;
 		for(const auto& config : configurations) {
-			if(configSelection.find(std::get<1>(config)) != std::string::npos) {
-				BenchResult res;
-				std::vector<long long> times;
-				for(unsigned i = 0; i < repeats; ++i) {
-					res = benchmark(x, c, std::get<0>(config), initializer);
-					times.push_back(std::get<1>(res));
-				}
-				long long mid_time = median(times);
-				double std_dev = stddev(times);
-				if(minoutput) {
-					std::cout << mid_time << "," << std_dev << std::endl;
-				} else if(csvoutput) {
-					std::cout << std::setw(16) << std::get<1>(config)
-						<< std::setw(2) << ", " << std::setw(14) << std::get<0>(res)
-						<< std::setw(2) << ", " << std::setw(14) << mid_time
-						<< std::setw(2) << ", " << std::setw(14) << std_dev << std::endl;
+			const auto& selected = settings.selectedConfigs;
+			if(std::find(selected.cbegin(), selected.cend(), std::get<1>(config)) == selected.cend()) continue;
+			// tenants of a mix have to run the same configurations, and not all of them might implement coroutines
+			if(std::get<0>(config) == launch::coroutine && (!coroutines || tenant)) continue;
+			for(unsigned threads : threadCounts) {
+				// deferred execution is sequential, measure it only once
+				if(std::get<0>(config) == launch::deferred && threads != threadCounts.front()) continue;
+				std::vector<unsigned> placement;
+				if(sweep) {
+					placement = sweep_placement(allowedCpus, threads);
+					set_thread_affinity(sweep_placement(allowedCpus, std::min(threads, static_cast<unsigned>(allowedCpus.size()))));
 				}
-				else {
-					std::cout << "launch: " << std::get<1>(config) << std::endl
-						<< "success: " << (std::get<0>(res) ? "SUCCESSFUL" : "FAILED") << std::endl
-						<< "time: " << mid_time << " ms" << std::endl
-						<< "stddev: " << std_dev << std::endl;
+				ConfigResult res;
+				res.launch = std::get<1>(config);
+				res.threads = threads;
+				res.granularity.calls = res.granularity.inlined = 0;
+				{
+					config_executor_scope scope(shared_executor(std::get<0>(config), threads, placement, settings), tenant);
+					for(unsigned i = 0; i < settings.warmups; ++i) {
+						BenchResult run = benchmark(x, c, std::get<0>(config), initializer);
+						res.warmupTimes.push_back(std::get<1>(run) / 1.0e6);
+					}
+					if(tenant) mix::synchronize();
+					std::vector<PerfCounts> perfRuns;
+					if(!tenant) tracing::begin_run(res.launch + ", " + std::to_string(threads) + " threads");
+					if(tenant && settings.repeats == 0) mix::recorded();
+					// tenants which are done continue as untimed background load of the others
+					for(unsigned i = 0; i < settings.repeats || (tenant && !mix::all_recorded()); ++i) {
+						BenchResult run = benchmark(x, c, std::get<0>(config), initializer);
+						if(i >= settings.repeats) continue;
+						res.verified.push_back(std::get<0>(run));
+						res.times.push_back(std::get<1>(run) / 1.0e6);
+						res.taskStats = std::get<2>(run);
+						perfRuns.push_back(std::get<3>(run));
+						if(!tenant) res.granularity = std::get<4>(run);
+						res.allocations.push_back(std::get<5>(run));
+						res.verifyTimes.push_back(std::get<6>(run) / 1.0e6);
+						if(tenant && i + 1 == settings.repeats) mix::recorded();
+					}
+					if(!tenant) tracing::end_run();
+					res.perfCounts = perf::average(perfRuns);
 				}
+				res.summary = statistics::summarize(res.times, settings.rejectOutliers);
+				if(printing) print_result(settings, res);
+				results.push_back(res);
 			}
 		}
+		if(sweep) set_thread_affinity(allowedCpus);
 
-		done = true;
+		if(!printing) current_sink()(bench, results);
+		else if(settings.jsonoutput) print_json(settings, bench, results);
+		if(!tenant) tracing::write();
+
+		done->store(true);
 	}
 
-	void message(const std::string& msg) {
+	inline void message(const std::string& msg) {
 		#ifdef INNCABS_MSG
 		std::cout << msg;
 		#endif
 	}
 
-	void debug(const std::string& msg) {
+	inline void debug(const std::string& msg) {
 		#ifdef INNCABS_DEBUG
 		std::cout << msg;
 		#endif
 	}
 
-	void error(const std::string& msg) {
+	inline void error(const std::string& msg) {
 		std::cerr << msg;
 		exit(-1);
 	}
 
+	// entry points of the benchmarks linked into the driver, by name
+	using benchmark_main = void(*)(int argc, char** argv);
 
-	//#define COUNTING_DEFER
-	#ifdef COUNTING_DEFER
-	std::atomic<unsigned> g_par_count;
-
-	template < class Function, class... Args >
-	auto async(std::launch policy, Function&& f, Args&&... args) 
-		-> typename std::enable_if< std::is_void<decltype(f(args...))>::value, decltype(std::async(policy, f, args...))>::type {
-		if(policy != (std::launch::deferred | std::launch::async)) return std::async(policy, f, args...);
-		if(g_par_count.fetch_add(1) < std::thread::hardware_concurrency()) {
-			return std::async(std::launch::async, [&]() {
-				f(args...);
-				g_par_count.fetch_sub(1);
-			});
-		}
-		else {
-			g_par_count.fetch_sub(1);
-		}
-		return std::async(std::launch::deferred, f, args...);
-	}
-
-	template < class Function, class... Args >
-	auto async(std::launch policy, Function&& f, Args&&... args) 
-		-> typename std::enable_if< !std::is_void<decltype(f(args...))>::value, decltype(std::async(policy, f, args...))>::type {
-		if(policy != (std::launch::deferred | std::launch::async)) return std::async(policy, f, args...);
-		if(g_par_count.fetch_add(1) < std::thread::hardware_concurrency()) {
-			return std::async(std::launch::async, [&]() {
-				auto ret = f(args...);
-				g_par_count.fetch_sub(1);
-				return ret;
-			});
-		}
-		else {
-			g_par_count.fetch_sub(1);
-		}
-		return std::async(std::launch::deferred, f, args...);
+	inline std::map<std::string, benchmark_main>& registry() {
+		static std::map<std::string, benchmark_main> benchmarks;
+		return benchmarks;
 	}
-	using std::async;
-	#endif
+
+	struct registrar {
+		registrar(const char* name, benchmark_main entry) { registry()[name] = entry; }
+	};
 }
+
+#include "service.h"
+#include "continuation.h"
+
+// declares the entry point of a benchmark: main for its own binary, or, when compiled for the driver
+// with INNCABS_DRIVER, a function registered under the given name
+#ifdef INNCABS_DRIVER
+#define INNCABS_MAIN(name) \
+	void name##_main(int argc, char** argv); \
+	static inncabs::registrar name##_registrar(#name, &name##_main); \
+	void name##_main(int argc, char** argv)
+#else
+#define INNCABS_MAIN(name) int main(int argc, char** argv)
+#endif
@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+ * Task instrumentation
+ *
+ * When enabled (INNCABS_TASK_STATS), every task spawned through inncabs::async is wrapped to record
+ * - the number of spawned tasks
+ * - whether a task ran on the thread which spawned it (inline, e.g. deferred tasks) or on another thread
+ * - the peak number of threads executing tasks at the same time
+ * - the task execution time, exclusive of nested tasks executed on the same thread
+ * The counters are shared atomics and the wrapper reads the clock twice per task, so fine-grained
+ * benchmarks are slowed down noticeably while it is active.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "platform.h"
+
+namespace inncabs {
+
+	struct TaskStats {
+		unsigned long long spawned;
+		unsigned long long inlined;
+		unsigned long long remote;
+		unsigned long long peak_threads;
+		double avg_task_us;
+	};
+
+	namespace instrumentation {
+		namespace detail {
+			struct padded_counter {
+				std::atomic<unsigned long long> value;
+				char padding[64 - sizeof(std::atomic<unsigned long long>)];
+			};
+
+			enum counter_id { SPAWNED, INLINED, REMOTE, TASK_NS, LIVE_THREADS, PEAK_THREADS, NUM_COUNTERS };
+
+			inline padded_counter* counters() {
+				static padded_counter c[NUM_COUNTERS];
+				return c;
+			}
+
+			inline std::atomic<bool>& enabled_flag() {
+				static std::atomic<bool> flag(false);
+				return flag;
+			}
+
+			inline unsigned& task_depth() {
+				static INNCABS_THREAD_LOCAL unsigned depth = 0;
+				return depth;
+			}
+
+			inline long long& nested_ns() {
+				static INNCABS_THREAD_LOCAL long long ns = 0;
+				return ns;
+			}
+
+			inline void add(counter_id id, unsigned long long v = 1) {
+				counters()[id].value.fetch_add(v, std::memory_order_relaxed);
+			}
+
+			// book-keeping for one task execution on the current thread
+			class task_scope {
+			public:
+				explicit task_scope(std::thread::id spawner) : start(std::chrono::steady_clock::now()), outer_nested(nested_ns()) {
+					add(spawner == std::this_thread::get_id() ? INLINED : REMOTE);
+					nested_ns() = 0;
+					if(task_depth()++ == 0) {
+						unsigned long long live = counters()[LIVE_THREADS].value.fetch_add(1) + 1;
+						std::atomic<unsigned long long>& peak = counters()[PEAK_THREADS].value;
+						unsigned long long cur = peak.load();
+						while(cur < live && !peak.compare_exchange_weak(cur, live)) {}
+					}
+				}
+				~task_scope() {
+					long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+					add(TASK_NS, static_cast<unsigned long long>(elapsed - nested_ns()));
+					nested_ns() = outer_nested + elapsed;
+					if(--task_depth() == 0) counters()[LIVE_THREADS].value.fetch_sub(1);
+				}
+			private:
+				task_scope(const task_scope&);
+				task_scope& operator=(const task_scope&);
+				std::chrono::steady_clock::time_point start;
+				long long outer_nested;
+			};
+
+			template<typename Function>
+			class instrumented_call {
+			public:
+				explicit instrumented_call(Function&& f) : fun(std::move(f)), spawner(std::this_thread::get_id()) {}
+				template<typename... Args>
+				auto operator()(Args&&... args) -> decltype(std::declval<Function&>()(std::forward<Args>(args)...)) {
+					task_scope scope(spawner);
+					return fun(std::forward<Args>(args)...);
+				}
+			private:
+				Function fun;
+				std::thread::id spawner;
+			};
+		}
+
+		inline bool enabled() {
+			return detail::enabled_flag().load(std::memory_order_relaxed);
+		}
+
+		inline void enable(bool on) {
+			detail::enabled_flag().store(on);
+		}
+
+		inline void reset() {
+			for(int i = 0; i < detail::NUM_COUNTERS; ++i) detail::counters()[i].value.store(0);
+		}
+
+		inline TaskStats snapshot() {
+			detail::padded_counter* c = detail::counters();
+			TaskStats s;
+			s.spawned = c[detail::SPAWNED].value.load();
+			s.inlined = c[detail::INLINED].value.load();
+			s.remote = c[detail::REMOTE].value.load();
+			s.peak_threads = c[detail::PEAK_THREADS].value.load();
+			unsigned long long executed = s.inlined + s.remote;
+			s.avg_task_us = executed > 0 ? c[detail::TASK_NS].value.load() / 1000.0 / executed : 0.0;
+			return s;
+		}
+
+		// wraps a task function for instrumentation, counts it as spawned
+		template<typename Function>
+		detail::instrumented_call<typename std::decay<Function>::type> wrap(Function&& f) {
+			detail::add(detail::SPAWNED);
+			typename std::decay<Function>::type fun(std::forward<Function>(f));
+			return detail::instrumented_call<typename std::decay<Function>::type>(std::move(fun));
+		}
+	}
+}
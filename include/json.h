@@ -0,0 +1,125 @@
+#pragma once
+
+/*
+ * Minimal streaming JSON writer used for machine-readable benchmark results
+ */
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+
+namespace inncabs {
+	namespace json {
+
+		inline std::string escape(const std::string& str) {
+			std::string ret;
+			for(char ch : str) {
+				switch(ch) {
+				case '"': ret += "\\\""; break;
+				case '\\': ret += "\\\\"; break;
+				case '\n': ret += "\\n"; break;
+				case '\r': ret += "\\r"; break;
+				case '\t': ret += "\\t"; break;
+				default:
+					if(static_cast<unsigned char>(ch) < 0x20) {
+						char buf[8];
+						snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned>(static_cast<unsigned char>(ch)));
+						ret += buf;
+					}
+					else {
+						ret += ch;
+					}
+				}
+			}
+			return ret;
+		}
+
+		// writes nested objects and arrays with indentation, inserting separators automatically
+		class writer {
+		public:
+			explicit writer(std::ostream& os) : out(os), first(true), afterKey(false) {}
+
+			writer& begin_object() { open('{'); return *this; }
+			writer& end_object() { close('}'); return *this; }
+			writer& begin_array() { open('['); return *this; }
+			writer& end_array() { close(']'); return *this; }
+
+			writer& key(const std::string& k) {
+				separate();
+				out << '"' << escape(k) << "\": ";
+				afterKey = true;
+				return *this;
+			}
+
+			writer& value(const std::string& v) { separate(); out << '"' << escape(v) << '"'; return *this; }
+			writer& value(const char* v) { return value(std::string(v)); }
+			writer& value(bool v) { separate(); out << (v ? "true" : "false"); return *this; }
+			writer& value(int v) { separate(); out << v; return *this; }
+			writer& value(unsigned v) { separate(); out << v; return *this; }
+			writer& value(long long v) { separate(); out << v; return *this; }
+			writer& value(long v) { separate(); out << v; return *this; }
+			writer& value(unsigned long v) { separate(); out << v; return *this; }
+			writer& value(unsigned long long v) { separate(); out << v; return *this; }
+			writer& value(double v) {
+				separate();
+				if(std::isfinite(v)) {
+					char buf[32];
+					snprintf(buf, sizeof(buf), "%.15g", v);
+					out << buf;
+				}
+				else {
+					out << "null";
+				}
+				return *this;
+			}
+			writer& null() { separate(); out << "null"; return *this; }
+
+			template<typename T>
+			writer& value(const std::vector<T>& vec) {
+				begin_array();
+				for(const auto& e : vec) value(e);
+				return end_array();
+			}
+
+			template<typename T>
+			writer& field(const std::string& k, const T& v) { key(k); return value(v); }
+
+		private:
+			void separate() {
+				if(afterKey) {
+					afterKey = false;
+					return;
+				}
+				if(!first) out << ',';
+				if(!levels.empty()) newline();
+				first = false;
+			}
+
+			void open(char bracket) {
+				separate();
+				out << bracket;
+				levels.push_back(bracket);
+				first = true;
+			}
+
+			void close(char bracket) {
+				levels.pop_back();
+				if(!first) newline();
+				out << bracket;
+				first = false;
+				if(levels.empty()) out << std::endl;
+			}
+
+			void newline() {
+				out << '\n' << std::string(levels.size(), '\t');
+			}
+
+			std::ostream& out;
+			std::vector<char> levels;
+			bool first;
+			bool afterKey;
+		};
+	}
+}
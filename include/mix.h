@@ -0,0 +1,87 @@
+#pragma once
+
+/*
+ * Concurrent multi-tenant runs
+ *
+ * In a mix, the driver runs several benchmarks at the same time, each calling run_all on a thread of
+ * its own. The tenants start every launch configuration together and share its executor. A tenant
+ * which has recorded all of its repetitions keeps repeating its benchmark untimed until every other
+ * tenant has recorded its own, so that each measured repetition overlaps with all other workloads.
+ */
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace inncabs {
+	namespace mix {
+		namespace detail {
+			struct mix_state {
+				mix_state() : tenants(0), arrived(0), generation(0), recorded(0) {}
+				std::mutex mutex;
+				std::condition_variable cv;
+				std::atomic<unsigned> tenants;
+				unsigned arrived;
+				unsigned long long generation;
+				std::atomic<unsigned> recorded;
+			};
+
+			inline mix_state& state() {
+				static mix_state s;
+				return s;
+			}
+		}
+
+		// whether benchmarks are currently run as tenants of a mix
+		inline bool active() {
+			return detail::state().tenants.load() > 0;
+		}
+
+		// starts a mix of the given number of tenants, before their threads are started
+		inline void begin(unsigned tenants) {
+			detail::mix_state& s = detail::state();
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.arrived = 0;
+			s.recorded.store(0);
+			s.tenants.store(tenants);
+		}
+
+		// ends the mix, after all tenant threads have been joined
+		inline void end() {
+			detail::state().tenants.store(0);
+		}
+
+		// waits until all tenants have arrived, the last one calls leader before releasing the others and
+		// resets the recorded count for the next configuration
+		template<typename Leader>
+		void synchronize(Leader leader) {
+			detail::mix_state& s = detail::state();
+			std::unique_lock<std::mutex> lock(s.mutex);
+			const unsigned long long generation = s.generation;
+			if(++s.arrived == s.tenants.load()) {
+				leader();
+				s.arrived = 0;
+				s.recorded.store(0);
+				++s.generation;
+				s.cv.notify_all();
+				return;
+			}
+			s.cv.wait(lock, [&s, generation] { return s.generation != generation; });
+		}
+
+		inline void synchronize() {
+			synchronize([] {});
+		}
+
+		// marks the repetitions of the calling tenant in the current configuration as recorded
+		inline void recorded() {
+			detail::state().recorded.fetch_add(1);
+		}
+
+		// whether every tenant has recorded its repetitions in the current configuration
+		inline bool all_recorded() {
+			detail::mix_state& s = detail::state();
+			return s.recorded.load() >= s.tenants.load();
+		}
+	}
+}
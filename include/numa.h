@@ -0,0 +1,164 @@
+#pragma once
+
+/*
+ * NUMA placement of benchmark data
+ *
+ * Benchmarks allocate their large input and output buffers through numa::alloc, which places the
+ * pages according to the policy selected with INNCABS_NUMA:
+ *
+ *   default     - plain malloc, pages end up on the node of the thread touching them first
+ *   interleave  - pages are distributed round-robin over all NUMA nodes (mbind MPOL_INTERLEAVE)
+ *   first-touch - the buffer is split into one contiguous block per available core, and each block
+ *                 is touched by a thread pinned to that core, as a worker processing it would
+ *   local       - pages are placed on the node of the allocating thread, regardless of which thread
+ *                 touches them first (mbind MPOL_PREFERRED)
+ *
+ * The policies calling mbind are Linux only, on other platforms and on single-node machines they
+ * behave like the default policy. mbind is invoked through syscall, so libnuma is not required.
+ */
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <thread>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+#include "platform.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace inncabs {
+	namespace numa {
+		const static char* ENV_VAR_NUMA = "INNCABS_NUMA";
+
+		enum policy { DEFAULT, INTERLEAVE, FIRST_TOUCH, LOCAL };
+
+		const static char* POLICY_NAMES[] = { "default", "interleave", "first-touch", "local" };
+
+		namespace detail {
+			#ifdef __linux__
+			// from linux/mempolicy.h, which is not installed everywhere
+			const int MPOL_PREFERRED_MODE = 1;
+			const int MPOL_INTERLEAVE_MODE = 3;
+			const unsigned MAX_NODES = sizeof(unsigned long) * 8;
+
+			// online nodes as a bit mask, parsed from a list like "0-1,3"
+			inline unsigned long online_nodes() {
+				unsigned long mask = 0;
+				std::ifstream in("/sys/devices/system/node/online");
+				std::string list;
+				if(!std::getline(in, list)) return 1;
+				std::stringstream ss(list);
+				std::string range;
+				while(std::getline(ss, range, ',')) {
+					unsigned first = 0, last = 0;
+					std::size_t dash = range.find('-');
+					first = static_cast<unsigned>(std::atoi(range.substr(0, dash).c_str()));
+					last = dash == std::string::npos ? first : static_cast<unsigned>(std::atoi(range.substr(dash + 1).c_str()));
+					for(unsigned n = first; n <= last && n < MAX_NODES; ++n) mask |= 1ul << n;
+				}
+				return mask ? mask : 1;
+			}
+
+			inline unsigned current_node() {
+				unsigned cpu = 0, node = 0;
+				if(syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) return 0;
+				return node < MAX_NODES ? node : 0;
+			}
+
+			// the kernel expects the number of mask bits plus one
+			inline bool bind(void* p, std::size_t bytes, int mode, unsigned long nodes) {
+				return syscall(SYS_mbind, p, bytes, mode, &nodes, MAX_NODES + 1, 0) == 0;
+			}
+			#endif
+
+			inline std::size_t page_size() {
+				#ifdef __linux__
+				long size = sysconf(_SC_PAGESIZE);
+				if(size > 0) return static_cast<std::size_t>(size);
+				#endif
+				return 4096;
+			}
+
+			// touches every page of [p, p + bytes) from threads pinned to the available cores, one contiguous block each
+			inline void distribute_pages(void* p, std::size_t bytes) {
+				const std::vector<unsigned> cpus = affinity_cpus();
+				const std::size_t page = page_size();
+				const std::size_t pages = (bytes + page - 1) / page;
+				const std::size_t workers = cpus.empty() ? 1 : cpus.size();
+				std::vector<std::thread> touchers;
+				for(std::size_t w = 0; w < workers; ++w) {
+					touchers.emplace_back([=] {
+						if(!cpus.empty()) set_thread_affinity(std::vector<unsigned>(1, cpus[w]));
+						volatile char* base = static_cast<char*>(p);
+						for(std::size_t i = pages * w / workers; i < pages * (w + 1) / workers; ++i) base[i * page] = 0;
+					});
+				}
+				for(auto& t : touchers) t.join();
+			}
+
+			inline policy read_policy() {
+				const char* val = getenv(ENV_VAR_NUMA);
+				if(!val) return DEFAULT;
+				for(int p = DEFAULT; p <= LOCAL; ++p) {
+					if(std::strcmp(val, POLICY_NAMES[p]) == 0) return static_cast<policy>(p);
+				}
+				std::cerr << "Unknown " << ENV_VAR_NUMA << " policy " << val << ", using default" << std::endl;
+				return DEFAULT;
+			}
+		}
+
+		// the policy selected for this process, read from the environment on first use
+		inline policy current_policy() {
+			static const policy p = detail::read_policy();
+			return p;
+		}
+
+		inline std::string policy_name() {
+			return POLICY_NAMES[current_policy()];
+		}
+
+		// allocates bytes according to the current policy, or returns nullptr if out of memory
+		// the memory is uninitialized and has to be released with numa::free
+		inline void* alloc(std::size_t bytes) {
+			const policy pol = current_policy();
+			if(pol == DEFAULT || bytes == 0) return std::malloc(bytes);
+			#ifdef __linux__
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if(p == MAP_FAILED) return nullptr;
+			const unsigned long nodes = detail::online_nodes();
+			// a failing mbind only loses the placement, the memory itself is usable
+			if(pol == INTERLEAVE && (nodes & (nodes - 1)) != 0) detail::bind(p, bytes, detail::MPOL_INTERLEAVE_MODE, nodes);
+			if(pol == LOCAL) detail::bind(p, bytes, detail::MPOL_PREFERRED_MODE, 1ul << detail::current_node());
+			#else
+			void* p = std::malloc(bytes);
+			if(!p) return nullptr;
+			#endif
+			if(pol == FIRST_TOUCH) detail::distribute_pages(p, bytes);
+			return p;
+		}
+
+		inline void free(void* p, std::size_t bytes) {
+			if(!p) return;
+			#ifdef __linux__
+			if(current_policy() != DEFAULT && bytes != 0) {
+				munmap(p, bytes);
+				return;
+			}
+			#endif
+			std::free(p);
+		}
+
+		template<typename T>
+		T* alloc_array(std::size_t count) {
+			return static_cast<T*>(alloc(count * sizeof(T)));
+		}
+	}
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+/*
+ * Hardware and software performance counters via Linux perf_event_open
+ *
+ * A counter session opens one group of hardware events (cycles, instructions, last level cache
+ * misses, branch misses) and one group of software events (context switches, CPU migrations) for
+ * every thread of the process, with inheritance enabled so that threads spawned during the
+ * measurement (e.g. by std::async) are accounted to their parent once they have been joined.
+ * Values are scaled by enabled/running time when the kernel multiplexes the counters.
+ *
+ * Counters that cannot be opened (non-Linux platforms, perf_event_paranoid restrictions, virtual
+ * machines without a PMU) are reported as unavailable.
+ */
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+namespace inncabs {
+
+	enum PerfEvent { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_BRANCH_MISSES, PERF_CONTEXT_SWITCHES, PERF_MIGRATIONS, NUM_PERF_EVENTS };
+
+	const static char* PERF_EVENT_NAMES[NUM_PERF_EVENTS] = { "cycles", "instructions", "llc misses", "branch misses", "context switches", "migrations" };
+
+	struct PerfCounts {
+		bool valid[NUM_PERF_EVENTS];
+		double values[NUM_PERF_EVENTS];
+	};
+
+	namespace perf {
+		namespace detail {
+			inline bool& enabled_flag() {
+				static bool flag = false;
+				return flag;
+			}
+
+			#ifdef __linux__
+			struct event_spec {
+				unsigned type;
+				unsigned long long config;
+			};
+
+			const event_spec EVENT_SPECS[NUM_PERF_EVENTS] = {
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+				{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+				{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+				{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS } };
+
+			inline int open_event(const event_spec& spec, pid_t tid, int group_fd, bool user_only) {
+				perf_event_attr attr;
+				memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = spec.type;
+				attr.config = spec.config;
+				attr.disabled = group_fd == -1 ? 1 : 0;
+				attr.inherit = 1;
+				attr.exclude_kernel = user_only ? 1 : 0;
+				attr.exclude_hv = user_only ? 1 : 0;
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				return static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, -1, group_fd, 0));
+			}
+
+			inline std::vector<pid_t> process_threads() {
+				std::vector<pid_t> tids;
+				DIR* dir = opendir("/proc/self/task");
+				if(!dir) return tids;
+				while(dirent* entry = readdir(dir)) {
+					if(entry->d_name[0] != '.') tids.push_back(static_cast<pid_t>(atoi(entry->d_name)));
+				}
+				closedir(dir);
+				return tids;
+			}
+			#endif
+		}
+
+		inline bool enabled() {
+			return detail::enabled_flag();
+		}
+
+		inline void enable(bool on) {
+			detail::enabled_flag() = on;
+		}
+
+		// per-event mean over several sessions, an event is valid if it was counted in all of them
+		inline PerfCounts average(const std::vector<PerfCounts>& runs) {
+			PerfCounts avg;
+			for(int e = 0; e < NUM_PERF_EVENTS; ++e) {
+				avg.valid[e] = !runs.empty();
+				avg.values[e] = 0.0;
+				for(const auto& r : runs) {
+					avg.valid[e] = avg.valid[e] && r.valid[e];
+					avg.values[e] += r.values[e] / runs.size();
+				}
+			}
+			return avg;
+		}
+
+		// formatted event count, "n/a" if the event could not be counted
+		inline std::string format(const PerfCounts& counts, int e) {
+			if(!counts.valid[e]) return "n/a";
+			return std::to_string(static_cast<unsigned long long>(counts.values[e] + 0.5));
+		}
+
+		// instructions per cycle, "n/a" if either could not be counted
+		inline std::string format_ipc(const PerfCounts& counts) {
+			if(!counts.valid[PERF_CYCLES] || !counts.valid[PERF_INSTRUCTIONS] || counts.values[PERF_CYCLES] == 0.0) return "n/a";
+			std::ostringstream ss;
+			ss << counts.values[PERF_INSTRUCTIONS] / counts.values[PERF_CYCLES];
+			return ss.str();
+		}
+
+		// counts the selected events for all threads of the process between start() and stop()
+		class session {
+		public:
+			session() : active(false) {}
+			~session() { close_all(); }
+
+			void start() {
+				#ifdef __linux__
+				for(pid_t tid : detail::process_threads()) {
+					open_group(tid, PERF_CYCLES, PERF_CONTEXT_SWITCHES);
+					open_group(tid, PERF_CONTEXT_SWITCHES, NUM_PERF_EVENTS);
+				}
+				for(int leader : leaders) {
+					ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+					ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+				}
+				active = true;
+				#endif
+			}
+
+			PerfCounts stop() {
+				PerfCounts counts;
+				for(int e = 0; e < NUM_PERF_EVENTS; ++e) {
+					counts.valid[e] = false;
+					counts.values[e] = 0.0;
+				}
+				#ifdef __linux__
+				if(!active) return counts;
+				for(int leader : leaders) ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+				for(const auto& c : counters) {
+					unsigned long long data[3];
+					if(read(c.fd, data, sizeof(data)) != sizeof(data)) continue;
+					counts.valid[c.event] = true;
+					if(data[2] > 0) counts.values[c.event] += static_cast<double>(data[0]) * data[1] / data[2];
+				}
+				active = false;
+				#endif
+				close_all();
+				return counts;
+			}
+
+		private:
+			struct counter {
+				int fd;
+				PerfEvent event;
+			};
+
+			#ifdef __linux__
+			// opens events [first, last) as one group for thread tid
+			void open_group(pid_t tid, int first, int last) {
+				int leader = -1;
+				for(int e = first; e < last; ++e) {
+					int fd = detail::open_event(detail::EVENT_SPECS[e], tid, leader, false);
+					if(fd < 0 && (errno == EACCES || errno == EPERM)) fd = detail::open_event(detail::EVENT_SPECS[e], tid, leader, true);
+					if(fd < 0) {
+						if(leader == -1) return;
+						continue;
+					}
+					if(leader == -1) {
+						leader = fd;
+						leaders.push_back(fd);
+					}
+					counters.push_back(counter { fd, static_cast<PerfEvent>(e) });
+				}
+			}
+			#endif
+
+			void close_all() {
+				#ifdef __linux__
+				for(const auto& c : counters) close(c.fd);
+				#endif
+				counters.clear();
+				leaders.clear();
+			}
+
+			session(const session&);
+			session& operator=(const session&);
+
+			bool active;
+			std::vector<counter> counters;
+			std::vector<int> leaders;
+		};
+	}
+}
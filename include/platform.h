@@ -0,0 +1,130 @@
+#pragma once
+
+/*
+ * Platform specifics shared by the inncabs runtime headers
+ */
+
+#include <thread>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define INNCABS_THREAD_LOCAL __declspec(thread)
+#else
+#define INNCABS_THREAD_LOCAL thread_local
+#endif
+
+namespace inncabs {
+	// cores this process is allowed to run on
+	inline std::vector<unsigned> affinity_cpus() {
+		std::vector<unsigned> cpus;
+		#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for(unsigned i = 0; i < CPU_SETSIZE; ++i) {
+				if(CPU_ISSET(i, &set)) cpus.push_back(i);
+			}
+		}
+		#elif defined(_WIN32)
+		DWORD_PTR processMask, systemMask;
+		if(GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+			for(unsigned i = 0; i < sizeof(processMask) * 8; ++i) {
+				if(processMask & (static_cast<DWORD_PTR>(1) << i)) cpus.push_back(i);
+			}
+		}
+		#endif
+		return cpus;
+	}
+
+	// number of cores this process is allowed to run on
+	inline unsigned available_cores() {
+		std::vector<unsigned> cpus = affinity_cpus();
+		if(!cpus.empty()) return static_cast<unsigned>(cpus.size());
+		unsigned n = std::thread::hardware_concurrency();
+		return n > 0 ? n : 1;
+	}
+
+	// restricts the calling thread to the given cores; on Linux, threads it creates afterwards inherit the restriction
+	inline bool set_thread_affinity(const std::vector<unsigned>& cpus) {
+		if(cpus.empty()) return false;
+		#if defined(__linux__)
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for(unsigned c : cpus) CPU_SET(c, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+		#elif defined(_WIN32)
+		DWORD_PTR mask = 0;
+		for(unsigned c : cpus) mask |= static_cast<DWORD_PTR>(1) << c;
+		return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+		#else
+		return false;
+		#endif
+	}
+
+	inline std::string compiler_version() {
+		std::stringstream ss;
+		#if defined(__clang__)
+		ss << "clang " << __clang_version__;
+		#elif defined(__GNUC__)
+		ss << "gcc " << __VERSION__;
+		#elif defined(_MSC_VER)
+		ss << "msvc " << _MSC_FULL_VER;
+		#else
+		ss << "unknown";
+		#endif
+		return ss.str();
+	}
+
+	inline std::string standard_library() {
+		std::stringstream ss;
+		#if defined(_LIBCPP_VERSION)
+		ss << "libc++ " << _LIBCPP_VERSION;
+		#elif defined(__GLIBCXX__)
+		ss << "libstdc++ " << __GLIBCXX__;
+		#elif defined(_CPPLIB_VER)
+		ss << "dinkumware " << _CPPLIB_VER;
+		#else
+		ss << "unknown";
+		#endif
+		return ss.str();
+	}
+
+	inline std::string host_name() {
+		char name[256] = { 0 };
+		#if defined(__linux__)
+		if(gethostname(name, sizeof(name) - 1) != 0) return "unknown";
+		#elif defined(_WIN32)
+		DWORD size = sizeof(name);
+		if(!GetComputerNameA(name, &size)) return "unknown";
+		#else
+		return "unknown";
+		#endif
+		return name;
+	}
+
+	// command line of the running process, empty if it cannot be determined
+	inline std::vector<std::string> command_line() {
+		std::vector<std::string> args;
+		#if defined(__linux__)
+		std::ifstream cmdline("/proc/self/cmdline", std::ios::binary);
+		std::string arg;
+		while(std::getline(cmdline, arg, '\0')) args.push_back(arg);
+		#elif defined(_WIN32)
+		args.push_back(GetCommandLineA());
+		#endif
+		return args;
+	}
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+/*
+ * Service mode
+ *
+ * Instead of measuring the makespan of a whole benchmark, a benchmark supporting the service mode
+ * issues a stream of short requests, each of them a small task graph, e.g. one fib(20). Requests
+ * arrive open-loop: their arrival times are drawn from a Poisson process with INNCABS_SERVICE_RATE
+ * requests per second, independently of how fast earlier requests complete. Every request is
+ * spawned with inncabs::async when it arrives, and its latency is measured from its scheduled
+ * arrival until it completes, so that a dispatcher falling behind is counted as well. Latencies are
+ * recorded in histograms, and reported as percentiles together with the achieved throughput.
+ *
+ * Settings: INNCABS_SERVICE_RATE (requests per second, enables the mode), INNCABS_SERVICE_REQUESTS
+ * (requests per launch configuration, default: 1000) and INNCABS_SERVICE_SEED (seed of the arrival
+ * process, default: 1). The deferred launch type runs nothing before it is waited for, and is skipped,
+ * as is the coroutine launch type, which needs coroutine variants of the requests.
+ *
+ * Included by inncabs.h, after the definitions it builds on.
+ */
+
+#include <random>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+
+#include "statistics.h"
+#include "json.h"
+
+namespace inncabs {
+	namespace service {
+		const static char* ENV_VAR_RATE = "INNCABS_SERVICE_RATE";
+		const static char* ENV_VAR_REQUESTS = "INNCABS_SERVICE_REQUESTS";
+		const static char* ENV_VAR_SEED = "INNCABS_SERVICE_SEED";
+
+		struct ServiceSettings {
+			double rate;						// requests per second
+			unsigned long long requests;
+			unsigned long long seed;
+		};
+
+		// measurements of one launch configuration
+		struct ServiceResult {
+			std::string launch;
+			unsigned threads;
+			unsigned long long requests;
+			unsigned long long failed;			// not completed or not verified
+			double duration_ms;					// from the first arrival until the last completion
+			double throughput;					// completed requests per second
+			statistics::histogram latency;		// ns from arrival to completion
+			statistics::histogram service;		// ns from the start of execution to completion
+		};
+
+		// whether the service mode was requested for this process
+		inline bool requested() {
+			return getenv(ENV_VAR_RATE) != nullptr;
+		}
+
+		inline ServiceSettings read_settings() {
+			ServiceSettings s;
+			s.rate = 100.0;
+			if(getenv(ENV_VAR_RATE)) s.rate = std::atof(getenv(ENV_VAR_RATE));
+			if(s.rate <= 0.0) s.rate = 100.0;
+			s.requests = 1000;
+			if(getenv(ENV_VAR_REQUESTS)) s.requests = std::max(1ll, std::atoll(getenv(ENV_VAR_REQUESTS)));
+			s.seed = 1;
+			if(getenv(ENV_VAR_SEED)) s.seed = std::strtoull(getenv(ENV_VAR_SEED), nullptr, 10);
+			return s;
+		}
+
+		template<typename Request, typename Checker>
+		ServiceResult measure(Request& r, Checker& c, const std::launch l, const ServiceSettings& s) {
+			using clock = std::chrono::steady_clock;
+			struct outcome {
+				clock::time_point start;
+				clock::time_point end;
+				bool completed;
+				bool verified;
+			};
+			// requests which throw, e.g. as no more threads can be started, count as failed
+			std::vector<outcome> outcomes(static_cast<std::size_t>(s.requests), outcome { clock::time_point(), clock::time_point(), false, false });
+			std::vector<clock::time_point> arrivals(static_cast<std::size_t>(s.requests));
+			std::vector<future<void>> futures;
+			futures.reserve(static_cast<std::size_t>(s.requests));
+
+			std::mt19937_64 rng(s.seed);
+			std::exponential_distribution<double> interarrival(s.rate);
+			const clock::time_point begin = clock::now();
+			double offset = 0.0;
+			for(unsigned long long k = 0; k < s.requests; ++k) {
+				offset += interarrival(rng);
+				arrivals[k] = begin + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(offset));
+				std::this_thread::sleep_until(arrivals[k]);
+				outcome* o = &outcomes[k];
+				try {
+					futures.push_back(inncabs::async(l, [&r, &c, o, l, k] {
+						try {
+							o->start = clock::now();
+							auto result = r(l, k);
+							o->end = clock::now();
+							o->completed = true;
+							o->verified = c(k, result);
+						}
+						catch(const std::exception&) {}
+					}));
+				}
+				catch(const std::exception&) {}
+			}
+			for(auto& f : futures) f.wait();
+
+			ServiceResult res;
+			res.requests = s.requests;
+			res.failed = 0;
+			clock::time_point last = arrivals.front();
+			unsigned long long completed = 0;
+			for(unsigned long long k = 0; k < s.requests; ++k) {
+				const outcome& o = outcomes[k];
+				if(!o.verified) ++res.failed;
+				if(!o.completed) continue;
+				++completed;
+				res.latency.record(static_cast<unsigned long long>(std::max(0ll,
+					static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(o.end - arrivals[k]).count()))));
+				res.service.record(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(o.end - o.start).count()));
+				last = std::max(last, o.end);
+			}
+			res.duration_ms = std::chrono::duration_cast<std::chrono::nanoseconds>(last - arrivals.front()).count() / 1.0e6;
+			res.throughput = res.duration_ms > 0.0 ? completed / (res.duration_ms / 1000.0) : 0.0;
+			return res;
+		}
+
+		inline void write_percentiles(json::writer& w, const statistics::histogram& h) {
+			w.begin_object();
+			w.field("p50", h.percentile(50) / 1000.0);
+			w.field("p90", h.percentile(90) / 1000.0);
+			w.field("p99", h.percentile(99) / 1000.0);
+			w.field("p999", h.percentile(99.9) / 1000.0);
+			w.field("max", h.max() / 1000.0);
+			w.end_object();
+		}
+
+		inline void print_result(const RunSettings& s, const ServiceSettings& ss, const ServiceResult& res) {
+			const statistics::histogram& h = res.latency;
+			if(s.jsonoutput) return;
+			if(s.minoutput) {
+				if(!s.threads.empty()) std::cout << res.threads << ",";
+				std::cout << res.throughput << "," << h.percentile(99) / 1000.0 << std::endl;
+			}
+			else if(s.csvoutput) {
+				std::cout << std::setw(16) << res.launch
+					<< std::setw(2) << ", " << std::setw(14) << res.threads
+					<< std::setw(2) << ", " << std::setw(14) << (res.failed == 0)
+					<< std::setw(2) << ", " << std::setw(14) << ss.rate
+					<< std::setw(2) << ", " << std::setw(14) << res.throughput
+					<< std::setw(2) << ", " << std::setw(14) << h.percentile(50) / 1000.0
+					<< std::setw(2) << ", " << std::setw(14) << h.percentile(90) / 1000.0
+					<< std::setw(2) << ", " << std::setw(14) << h.percentile(99) / 1000.0
+					<< std::setw(2) << ", " << std::setw(14) << h.percentile(99.9) / 1000.0
+					<< std::setw(2) << ", " << std::setw(14) << h.max() / 1000.0 << std::endl;
+			}
+			else {
+				std::cout << "launch: " << res.launch << std::endl
+					<< "threads: " << res.threads << std::endl
+					<< "success: " << (res.failed == 0 ? "SUCCESSFUL" : "FAILED") << std::endl
+					<< "requests: " << res.requests << " (" << res.failed << " failed)" << std::endl
+					<< "offered / achieved: " << ss.rate << " / " << res.throughput << " requests/s" << std::endl
+					<< "latency p50 / p90 / p99 / p99.9 / max: " << h.percentile(50) / 1000.0 << " / " << h.percentile(90) / 1000.0
+					<< " / " << h.percentile(99) / 1000.0 << " / " << h.percentile(99.9) / 1000.0 << " / " << h.max() / 1000.0 << " us" << std::endl
+					<< "service time p50 / p99: " << res.service.percentile(50) / 1000.0 << " / " << res.service.percentile(99) / 1000.0 << " us" << std::endl;
+			}
+		}
+
+		inline void print_json(const RunSettings& s, const ServiceSettings& ss, const std::string& bench, const std::vector<ServiceResult>& results) {
+			json::writer w(std::cout);
+			w.begin_object();
+			w.field("benchmark", bench);
+			w.field("mode", "service");
+			w.field("arguments", command_line());
+			write_environment(w);
+
+			w.key("settings").begin_object();
+			w.field("rate", ss.rate);
+			w.field("requests", ss.requests);
+			w.field("seed", ss.seed);
+			w.field("threads", s.threads);
+			w.field("numa", numa::policy_name());
+			w.field("split_depth", s.splitDepth);
+			w.end_object();
+
+			w.key("results").begin_array();
+			for(const auto& res : results) {
+				w.begin_object();
+				w.field("launch", res.launch);
+				w.field("threads", res.threads);
+				w.field("success", res.failed == 0);
+				w.field("requests", res.requests);
+				w.field("failed", res.failed);
+				w.field("duration_ms", res.duration_ms);
+				w.field("throughput", res.throughput);
+				w.key("latency_us");
+				write_percentiles(w, res.latency);
+				w.key("service_us");
+				write_percentiles(w, res.service);
+				// lower bound in us and count of every non-empty bucket
+				w.key("latency_histogram").begin_array();
+				for(const auto& b : res.latency.buckets()) {
+					w.begin_array().value(b.first / 1000.0).value(b.second).end_array();
+				}
+				w.end_array();
+				w.end_object();
+			}
+			w.end_array();
+			w.end_object();
+		}
+	}
+
+	// measures a stream of requests for every selected launch configuration instead of a whole run
+	// the request is called with the launch policy and the index of the request, and the checker with
+	// the index and the result of the request
+	template<typename Request, typename Checker>
+	void serve(Request r, Checker c, const std::string& bench) {
+		RunSettings settings = read_settings();
+		const service::ServiceSettings serviceSettings = service::read_settings();
+
+		if(settings.csvoutput) {
+			std::cout << std::setw(16) << bench << ", threads" << ", success" << ", offered (1/s)" << ", achieved (1/s)"
+				<< ", p50 (us)" << ", p90 (us)" << ", p99 (us)" << ", p99.9 (us)" << ", max (us)" << std::endl;
+		}
+		else if(!settings.jsonoutput && !settings.minoutput) {
+			std::cout << "Serving " << bench << std::endl;
+		}
+
+		const bool sweep = !settings.threads.empty();
+		const std::vector<unsigned> allowedCpus = affinity_cpus();
+		std::vector<unsigned> threadCounts = settings.threads;
+		if(!sweep) threadCounts.push_back(available_cores());
+
+		std::vector<service::ServiceResult> results;
+		for(const auto& config : launch_configurations()) {
+			const auto& selected = settings.selectedConfigs;
+			if(std::find(selected.cbegin(), selected.cend(), std::get<1>(config)) == selected.cend()) continue;
+			if(std::get<0>(config) == std::launch::deferred || std::get<0>(config) == launch::coroutine) continue;
+			for(unsigned threads : threadCounts) {
+				std::vector<unsigned> placement;
+				if(sweep) {
+					placement = sweep_placement(allowedCpus, threads);
+					set_thread_affinity(sweep_placement(allowedCpus, std::min(threads, static_cast<unsigned>(allowedCpus.size()))));
+				}
+				executor_scope scope(shared_executor(std::get<0>(config), threads, placement, settings));
+				service::ServiceResult res = service::measure(r, c, std::get<0>(config), serviceSettings);
+				res.launch = std::get<1>(config);
+				res.threads = threads;
+				service::print_result(settings, serviceSettings, res);
+				results.push_back(res);
+			}
+		}
+		if(sweep) set_thread_affinity(allowedCpus);
+
+		if(settings.jsonoutput) service::print_json(settings, serviceSettings, bench, results);
+	}
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+/*
+ * Statistics over repeated benchmark runs
+ *
+ * Percentiles interpolate linearly between the closest ranks, the standard deviation is the sample
+ * standard deviation, and the confidence interval of the mean is based on Student's t distribution.
+ * Outliers are rejected with Tukey's fences (outside 1.5 interquartile ranges of the quartiles).
+ *
+ * Latencies of many requests are recorded in a histogram with logarithmic buckets, each of them
+ * split into 128 linear sub-buckets like HdrHistogram, so that every recorded value is known to
+ * within 1% at a fixed memory cost.
+ */
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace inncabs {
+	namespace statistics {
+
+		struct Summary {
+			std::size_t samples;
+			std::size_t outliers;
+			double mean;
+			double stddev;
+			double min;
+			double max;
+			double p50;
+			double p90;
+			double p99;
+			double ci95_low;
+			double ci95_high;
+		};
+
+		inline double mean(const std::vector<double>& vec) {
+			if(vec.empty()) return 0.0;
+			double sum = 0.0;
+			for(double e : vec) sum += e;
+			return sum / vec.size();
+		}
+
+		inline double stddev(const std::vector<double>& vec) {
+			if(vec.size() < 2) return 0.0;
+			double m = mean(vec);
+			double dsum = 0.0;
+			for(double e : vec) dsum += (e - m) * (e - m);
+			return std::sqrt(dsum / (vec.size() - 1));
+		}
+
+		// p in [0,100]
+		inline double percentile(std::vector<double> vec, double p) {
+			if(vec.empty()) return 0.0;
+			std::sort(vec.begin(), vec.end());
+			double rank = p / 100.0 * (vec.size() - 1);
+			std::size_t lower = static_cast<std::size_t>(std::floor(rank));
+			std::size_t upper = static_cast<std::size_t>(std::ceil(rank));
+			return vec[lower] + (rank - lower) * (vec[upper] - vec[lower]);
+		}
+
+		inline double median(const std::vector<double>& vec) {
+			return percentile(vec, 50.0);
+		}
+
+		// two-sided 95% quantile of Student's t distribution
+		inline double student_t95(std::size_t df) {
+			static const double table[] = {
+				12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+				2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+				2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042 };
+			if(df == 0) return 0.0;
+			if(df <= 30) return table[df - 1];
+			return 1.96 + 2.4 / df;
+		}
+
+		// returns the samples within Tukey's fences, rejection requires at least 4 samples
+		inline std::vector<double> reject_outliers(const std::vector<double>& vec) {
+			if(vec.size() < 4) return vec;
+			double q1 = percentile(vec, 25.0);
+			double q3 = percentile(vec, 75.0);
+			double fence = 1.5 * (q3 - q1);
+			std::vector<double> ret;
+			std::copy_if(vec.cbegin(), vec.cend(), std::back_inserter(ret), [&](double e) { return e >= q1 - fence && e <= q3 + fence; });
+			return ret;
+		}
+
+		inline Summary summarize(const std::vector<double>& samples, bool rejectOutliers) {
+			std::vector<double> vec = rejectOutliers ? reject_outliers(samples) : samples;
+			Summary s;
+			s.samples = vec.size();
+			s.outliers = samples.size() - vec.size();
+			s.mean = mean(vec);
+			s.stddev = stddev(vec);
+			s.min = vec.empty() ? 0.0 : *std::min_element(vec.cbegin(), vec.cend());
+			s.max = vec.empty() ? 0.0 : *std::max_element(vec.cbegin(), vec.cend());
+			s.p50 = percentile(vec, 50.0);
+			s.p90 = percentile(vec, 90.0);
+			s.p99 = percentile(vec, 99.0);
+			double halfwidth = vec.size() > 1 ? student_t95(vec.size() - 1) * s.stddev / std::sqrt(static_cast<double>(vec.size())) : 0.0;
+			s.ci95_low = s.mean - halfwidth;
+			s.ci95_high = s.mean + halfwidth;
+			return s;
+		}
+
+		// histogram of non-negative integer values, e.g. latencies in nanoseconds
+		class histogram {
+		public:
+			histogram() : counts(64 * SUB_BUCKETS, 0), total(0), maximum(0) {}
+
+			void record(unsigned long long value) {
+				++counts[index(value)];
+				++total;
+				maximum = std::max(maximum, value);
+			}
+
+			void merge(const histogram& other) {
+				for(std::size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+				total += other.total;
+				maximum = std::max(maximum, other.maximum);
+			}
+
+			unsigned long long count() const { return total; }
+			unsigned long long max() const { return maximum; }
+
+			// upper end of the bucket containing the value at p in [0,100], the exact maximum for p = 100
+			unsigned long long percentile(double p) const {
+				if(total == 0) return 0;
+				const unsigned long long rank = std::max(1ull, static_cast<unsigned long long>(std::ceil(p / 100.0 * total)));
+				if(rank >= total) return maximum;
+				unsigned long long seen = 0;
+				for(std::size_t i = 0; i < counts.size(); ++i) {
+					seen += counts[i];
+					if(seen >= rank) return std::min(maximum, lower_bound(i + 1) - 1);
+				}
+				return maximum;
+			}
+
+			// lower bound and count of every non-empty bucket
+			std::vector<std::pair<unsigned long long, unsigned long long>> buckets() const {
+				std::vector<std::pair<unsigned long long, unsigned long long>> ret;
+				for(std::size_t i = 0; i < counts.size(); ++i) {
+					if(counts[i] > 0) ret.push_back(std::make_pair(lower_bound(i), counts[i]));
+				}
+				return ret;
+			}
+
+		private:
+			static const unsigned SUB_BITS = 7;
+			static const unsigned SUB_BUCKETS = 1u << SUB_BITS;
+
+			// values below SUB_BUCKETS are exact, above, the bucket is given by the highest set bit
+			static std::size_t index(unsigned long long value) {
+				if(value < SUB_BUCKETS) return static_cast<std::size_t>(value);
+				unsigned msb = 0;
+				while((value >> msb) > 1) ++msb;
+				const unsigned shift = msb - SUB_BITS;
+				return static_cast<std::size_t>((shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS));
+			}
+
+			static unsigned long long lower_bound(std::size_t i) {
+				if(i < SUB_BUCKETS) return i;
+				const unsigned shift = static_cast<unsigned>(i / SUB_BUCKETS) - 1;
+				return (static_cast<unsigned long long>(i % SUB_BUCKETS) + SUB_BUCKETS) << shift;
+			}
+
+			std::vector<unsigned long long> counts;
+			unsigned long long total;
+			unsigned long long maximum;
+		};
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+/*
+ * Threads of continuation-style futures
+ *
+ * Under the async and optional launch policies, dataflow::async and then() start a thread of their own
+ * for every function. Nothing waits on these threads directly: a thread completes the shared state of
+ * its future and then still runs the epilogue of its function (instrumentation and tracing wrappers,
+ * thread-local teardown) after get() may already have returned. To keep this work within the run
+ * which caused it, every such thread is registered with the registry of the thread_scope it was
+ * started under, and the scope joins all of them. Threads started by these threads are registered
+ * with the same registry. Threads which have finished are joined whenever another thread is
+ * registered, so that a long run does not accumulate finished threads.
+ *
+ * benchmark() opens a scope around every repetition. Threads started outside of any scope are
+ * registered with a process-wide registry, which joins them at exit.
+ */
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <utility>
+
+#include "platform.h"
+
+namespace inncabs {
+	namespace dataflow {
+		namespace detail {
+			class thread_registry;
+
+			// the registry threads started by the calling thread are added to, nullptr outside of any scope
+			inline thread_registry*& current_registry() {
+				static INNCABS_THREAD_LOCAL thread_registry* registry = nullptr;
+				return registry;
+			}
+
+			class thread_registry {
+			public:
+				thread_registry() {}
+				~thread_registry() { join(); }
+
+				// starts a thread running f, which inherits this registry for the threads it starts itself
+				template<typename F>
+				void start(F&& f) {
+					std::unique_ptr<std::atomic<bool>> done(new std::atomic<bool>(false));
+					std::thread t(registered_call<typename std::decay<F>::type>(this, done.get(), std::forward<F>(f)));
+					std::vector<entry> finished;
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						for(std::size_t i = 0; i < entries.size();) {
+							if(entries[i].done->load(std::memory_order_acquire)) {
+								finished.push_back(std::move(entries[i]));
+								entries[i] = std::move(entries.back());
+								entries.pop_back();
+							}
+							else ++i;
+						}
+						entries.push_back(entry(std::move(t), std::move(done)));
+					}
+					for(auto& e : finished) e.thread.join();
+				}
+
+				// joins all registered threads, including those started while joining
+				void join() {
+					for(;;) {
+						std::vector<entry> running;
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							running.swap(entries);
+						}
+						if(running.empty()) return;
+						for(auto& e : running) e.thread.join();
+					}
+				}
+
+			private:
+				thread_registry(const thread_registry&);
+				thread_registry& operator=(const thread_registry&);
+
+				struct entry {
+					entry(std::thread&& t, std::unique_ptr<std::atomic<bool>>&& d) : thread(std::move(t)), done(std::move(d)) {}
+					std::thread thread;
+					std::unique_ptr<std::atomic<bool>> done;	// set once the function and its wrappers have returned
+				};
+
+				template<typename Fn>
+				class registered_call {
+				public:
+					registered_call(thread_registry* r, std::atomic<bool>* d, Fn&& f) : registry(r), done(d), fun(std::move(f)) {}
+					registered_call(thread_registry* r, std::atomic<bool>* d, const Fn& f) : registry(r), done(d), fun(f) {}
+					void operator()() {
+						current_registry() = registry;
+						fun();
+						done->store(true, std::memory_order_release);
+					}
+				private:
+					thread_registry* registry;
+					std::atomic<bool>* done;
+					Fn fun;
+				};
+
+				std::mutex mutex;
+				std::vector<entry> entries;
+			};
+
+			inline thread_registry& process_registry() {
+				static thread_registry registry;
+				return registry;
+			}
+
+			// starts f on a thread registered with the calling thread's registry
+			template<typename F>
+			void start_thread(F&& f) {
+				thread_registry* registry = current_registry();
+				if(!registry) registry = &process_registry();
+				registry->start(std::forward<F>(f));
+			}
+		}
+
+		// threads started for continuation-style futures by the calling thread during the lifetime of the
+		// scope, and by the threads they start, are joined by join() and at the end of the scope
+		class thread_scope {
+		public:
+			thread_scope() : previous(detail::current_registry()) { detail::current_registry() = &threads; }
+			~thread_scope() {
+				threads.join();
+				detail::current_registry() = previous;
+			}
+			void join() { threads.join(); }
+		private:
+			thread_scope(const thread_scope&);
+			thread_scope& operator=(const thread_scope&);
+			detail::thread_registry threads;
+			detail::thread_registry* previous;
+		};
+	}
+}
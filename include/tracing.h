@@ -0,0 +1,289 @@
+#pragma once
+
+/*
+ * Task execution tracing
+ *
+ * When enabled (INNCABS_TRACE=<file>), every task spawned through inncabs::async records its spawn,
+ * the start and end of its execution, and every future wait records its start and end. Events are
+ * written to a ring buffer owned by the recording thread, so no locks or shared atomics are touched on
+ * the hot path. Each buffer is allocated once, when its thread records its first event, and holds
+ * INNCABS_TRACE_EVENTS events (default: 1048576), after which it wraps around and overwrites its
+ * oldest events. The buffers of threads which have exited are reused by new threads, which keeps the
+ * number of buffers bounded by the number of concurrent threads when every task runs on a thread of
+ * its own. Trace buffers are not part of the allocation statistics.
+ *
+ * Only the timed repetitions are traced. At the end of run_all, all buffers are written to the file
+ * in the Chrome trace event format, which can be opened in chrome://tracing or ui.perfetto.dev: every
+ * launch configuration is a process, every thread which recorded events a thread, and spawns are
+ * connected to the start of the spawned task by flow arrows.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <type_traits>
+#include <cstdlib>
+
+#include "platform.h"
+#include "json.h"
+#include "allocation.h"
+
+namespace inncabs {
+	namespace tracing {
+		const static char* ENV_VAR_TRACE = "INNCABS_TRACE";
+		const static char* ENV_VAR_TRACE_EVENTS = "INNCABS_TRACE_EVENTS";
+
+		namespace detail {
+			enum event_type { SPAWN, TASK_BEGIN, TASK_END, WAIT_BEGIN, WAIT_END };
+
+			struct event {
+				long long ns;				// since the trace epoch
+				unsigned long long task;	// task id, 0 for waits
+				unsigned run;
+				event_type type;
+			};
+
+			// written by the thread currently owning it only, read once all threads have finished recording
+			struct thread_buffer {
+				thread_buffer(unsigned i, std::size_t c) : index(i), capacity(c), events(new event[c]), written(0) {}
+				const unsigned index;
+				const std::size_t capacity;
+				std::unique_ptr<event[]> events;
+				std::atomic<unsigned long long> written;
+			};
+
+			struct trace_state {
+				trace_state() : active(false), run(0), next_task(1), capacity(1 << 20), epoch(std::chrono::steady_clock::now()) {}
+				std::atomic<bool> active;
+				std::atomic<unsigned> run;
+				std::atomic<unsigned long long> next_task;
+				std::size_t capacity;
+				std::chrono::steady_clock::time_point epoch;
+				std::string file;
+				std::vector<std::string> run_names;
+				std::mutex registry_mutex;
+				std::vector<std::unique_ptr<thread_buffer>> buffers;
+				std::vector<thread_buffer*> unowned;		// buffers of exited threads
+			};
+
+			inline trace_state& state() {
+				static trace_state s;
+				return s;
+			}
+
+			// returns the buffer of its thread to the registry when the thread exits
+			struct buffer_owner {
+				buffer_owner() : buffer(nullptr) {}
+				~buffer_owner() {
+					if(!buffer) return;
+					trace_state& s = state();
+					allocation::uncounted_scope uncounted;
+					std::lock_guard<std::mutex> lock(s.registry_mutex);
+					s.unowned.push_back(buffer);
+				}
+				thread_buffer* buffer;
+			};
+
+			inline thread_buffer& local_buffer() {
+				static INNCABS_THREAD_LOCAL buffer_owner owner;
+				if(!owner.buffer) {
+					trace_state& s = state();
+					allocation::uncounted_scope uncounted;
+					std::lock_guard<std::mutex> lock(s.registry_mutex);
+					if(!s.unowned.empty()) {
+						owner.buffer = s.unowned.back();
+						s.unowned.pop_back();
+					}
+					else {
+						s.buffers.emplace_back(new thread_buffer(static_cast<unsigned>(s.buffers.size()), s.capacity));
+						owner.buffer = s.buffers.back().get();
+					}
+				}
+				return *owner.buffer;
+			}
+
+			inline void record(event_type type, unsigned long long task) {
+				trace_state& s = state();
+				thread_buffer& b = local_buffer();
+				event e = { std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s.epoch).count(),
+					task, s.run.load(std::memory_order_relaxed), type };
+				unsigned long long n = b.written.load(std::memory_order_relaxed);
+				b.events[n % b.capacity] = e;
+				b.written.store(n + 1, std::memory_order_release);
+			}
+
+			template<typename Function>
+			class traced_call {
+			public:
+				traced_call(Function&& f, unsigned long long task_id) : fun(std::move(f)), id(task_id) {}
+				template<typename... Args>
+				auto operator()(Args&&... args) -> decltype(std::declval<Function&>()(std::forward<Args>(args)...)) {
+					struct end_guard {
+						explicit end_guard(unsigned long long i) : id(i) {}
+						~end_guard() { record(TASK_END, id); }
+						unsigned long long id;
+					} guard(id);
+					record(TASK_BEGIN, id);
+					return fun(std::forward<Args>(args)...);
+				}
+			private:
+				Function fun;
+				unsigned long long id;
+			};
+
+			inline void write_event(json::writer& w, const char* name, const char* phase, unsigned pid, unsigned tid, long long ns) {
+				w.field("name", name);
+				w.field("ph", phase);
+				w.field("pid", pid);
+				w.field("tid", tid);
+				w.field("ts", ns / 1000.0);
+			}
+		}
+
+		// whether tracing was requested for this process
+		inline bool configured() {
+			return !detail::state().file.empty();
+		}
+
+		// whether events are being recorded right now
+		inline bool enabled() {
+			return detail::state().active.load(std::memory_order_relaxed);
+		}
+
+		// reads the trace settings from the environment
+		inline void configure() {
+			detail::trace_state& s = detail::state();
+			if(getenv(ENV_VAR_TRACE)) s.file = getenv(ENV_VAR_TRACE);
+			if(getenv(ENV_VAR_TRACE_EVENTS)) s.capacity = std::max(1l, std::atol(getenv(ENV_VAR_TRACE_EVENTS)));
+		}
+
+		// starts recording the events of a launch configuration, which is shown as a separate process
+		inline void begin_run(const std::string& name) {
+			detail::trace_state& s = detail::state();
+			if(!configured()) return;
+			s.run.store(static_cast<unsigned>(s.run_names.size()));
+			s.run_names.push_back(name);
+			s.active.store(true);
+		}
+
+		inline void end_run() {
+			detail::state().active.store(false);
+		}
+
+		// wraps a task function for tracing, records its spawn on the calling thread
+		template<typename Function>
+		detail::traced_call<typename std::decay<Function>::type> wrap(Function&& f) {
+			unsigned long long id = detail::state().next_task.fetch_add(1, std::memory_order_relaxed);
+			detail::record(detail::SPAWN, id);
+			typename std::decay<Function>::type fun(std::forward<Function>(f));
+			return detail::traced_call<typename std::decay<Function>::type>(std::move(fun), id);
+		}
+
+		// records a wait on a future for the lifetime of the scope
+		class wait_scope {
+		public:
+			wait_scope() : traced(enabled()) { if(traced) detail::record(detail::WAIT_BEGIN, 0); }
+			~wait_scope() { if(traced) detail::record(detail::WAIT_END, 0); }
+		private:
+			wait_scope(const wait_scope&);
+			wait_scope& operator=(const wait_scope&);
+			bool traced;
+		};
+
+		// writes all recorded events to the configured file, may only be called once no thread records events anymore
+		inline void write() {
+			detail::trace_state& s = detail::state();
+			if(!configured()) return;
+			std::ofstream out(s.file);
+			if(!out) {
+				std::cerr << "Could not write trace to " << s.file << std::endl;
+				return;
+			}
+			unsigned long long dropped = 0;
+			std::set<std::pair<unsigned, unsigned>> named_threads;
+			json::writer w(out);
+			w.begin_object();
+			w.field("displayTimeUnit", "ns");
+			w.key("traceEvents").begin_array();
+			for(unsigned run = 0; run < s.run_names.size(); ++run) {
+				w.begin_object();
+				w.field("name", "process_name");
+				w.field("ph", "M");
+				w.field("pid", run);
+				w.key("args").begin_object().field("name", s.run_names[run]).end_object();
+				w.end_object();
+			}
+			std::lock_guard<std::mutex> lock(s.registry_mutex);
+			for(const auto& b : s.buffers) {
+				const unsigned long long written = b->written.load(std::memory_order_acquire);
+				const std::size_t count = static_cast<std::size_t>(std::min<unsigned long long>(written, b->capacity));
+				if(written > count) dropped += written - count;
+				// oldest event first
+				for(std::size_t i = 0; i < count; ++i) {
+					const detail::event& e = b->events[written > count ? (written + i) % count : i];
+					if(named_threads.insert(std::make_pair(e.run, b->index)).second) {
+						w.begin_object();
+						w.field("name", "thread_name");
+						w.field("ph", "M");
+						w.field("pid", e.run);
+						w.field("tid", b->index);
+						w.key("args").begin_object().field("name", "thread " + std::to_string(b->index)).end_object();
+						w.end_object();
+					}
+					switch(e.type) {
+					case detail::SPAWN:
+						w.begin_object();
+						detail::write_event(w, "spawn", "i", e.run, b->index, e.ns);
+						w.field("s", "t");
+						w.key("args").begin_object().field("task", e.task).end_object();
+						w.end_object();
+						w.begin_object();
+						detail::write_event(w, "task", "s", e.run, b->index, e.ns);
+						w.field("cat", "spawn");
+						w.field("id", e.task);
+						w.end_object();
+						break;
+					case detail::TASK_BEGIN:
+						w.begin_object();
+						detail::write_event(w, "task", "f", e.run, b->index, e.ns);
+						w.field("cat", "spawn");
+						w.field("id", e.task);
+						w.field("bp", "e");
+						w.end_object();
+						w.begin_object();
+						detail::write_event(w, "task", "B", e.run, b->index, e.ns);
+						w.key("args").begin_object().field("task", e.task).end_object();
+						w.end_object();
+						break;
+					case detail::TASK_END:
+						w.begin_object();
+						detail::write_event(w, "task", "E", e.run, b->index, e.ns);
+						w.end_object();
+						break;
+					case detail::WAIT_BEGIN:
+						w.begin_object();
+						detail::write_event(w, "wait", "B", e.run, b->index, e.ns);
+						w.end_object();
+						break;
+					case detail::WAIT_END:
+						w.begin_object();
+						detail::write_event(w, "wait", "E", e.run, b->index, e.ns);
+						w.end_object();
+						break;
+					}
+				}
+			}
+			w.end_array();
+			w.key("otherData").begin_object().field("dropped_events", dropped).end_object();
+			w.end_object();
+		}
+	}
+}
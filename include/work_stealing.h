@@ -0,0 +1,239 @@
+#pragma once
+
+/*
+ * Work-stealing runtime
+ *
+ * Every worker owns a Chase-Lev deque (D. Chase and Y. Lev, "Dynamic Circular Work-Stealing Deque",
+ * SPAA 2005; memory orderings as given by N.M. Le et al., "Correct and Efficient Work-Stealing for
+ * Weak Memory Models", PPoPP 2013). The owner pushes and pops tasks at the bottom without taking
+ * any lock, thieves take the oldest task from the top with a single CAS. Workers running out of
+ * work steal from randomly selected victims.
+ *
+ * Spawning is help-first: inncabs::async pushes the new task and the parent continues. A worker
+ * waiting on a future does not block, it keeps popping from its own deque and stealing until the
+ * awaited task has finished. Tasks submitted by threads outside the pool go through a shared
+ * injection queue.
+ *
+ * With a split depth, the pool implements the adaptive launch type using lazy binary splitting
+ * (A. Tzannes et al., "Lazy Binary-Splitting: A Run-Time Adaptive Work-Stealing Scheduler", PPoPP
+ * 2010): a worker only spawns a task while its own deque holds fewer tasks than the split depth or
+ * another worker has gone idle, and otherwise runs it inline right away. Thieves emptying the deque
+ * thereby signal demand for parallelism, and the task granularity adapts at every call.
+ */
+
+#include "executor.h"
+
+#include <cstdint>
+
+namespace inncabs {
+
+	namespace detail {
+		// single-owner, multi-thief deque of pointers; push and pop may only be called by the owner
+		template<typename T>
+		class chase_lev_deque {
+		public:
+			explicit chase_lev_deque(std::size_t capacity = 1024) : top(0), bottom(0), buffer(new ring(capacity)) {}
+			~chase_lev_deque() { delete buffer.load(); }
+
+			void push(T* x) {
+				std::int64_t b = bottom.load(std::memory_order_relaxed);
+				std::int64_t t = top.load(std::memory_order_acquire);
+				ring* a = buffer.load(std::memory_order_relaxed);
+				if(b - t > static_cast<std::int64_t>(a->capacity) - 1) a = grow(a, t, b);
+				a->put(b, x);
+				std::atomic_thread_fence(std::memory_order_release);
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+
+			T* pop() {
+				std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+				ring* a = buffer.load(std::memory_order_relaxed);
+				bottom.store(b, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t t = top.load(std::memory_order_relaxed);
+				if(t > b) {
+					// empty
+					bottom.store(b + 1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				T* x = a->get(b);
+				if(t == b) {
+					// last element, race against thieves
+					if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) x = nullptr;
+					bottom.store(b + 1, std::memory_order_relaxed);
+				}
+				return x;
+			}
+
+			// returns nullptr if the deque is empty or the steal lost a race
+			T* steal() {
+				std::int64_t t = top.load(std::memory_order_acquire);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				std::int64_t b = bottom.load(std::memory_order_acquire);
+				if(t >= b) return nullptr;
+				ring* a = buffer.load(std::memory_order_acquire);
+				T* x = a->get(t);
+				if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+				return x;
+			}
+
+			bool empty() const {
+				return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+			}
+
+			// approximate when called by a thief, exact when called by the owner
+			std::size_t size() const {
+				std::int64_t n = bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+				return n > 0 ? static_cast<std::size_t>(n) : 0;
+			}
+
+		private:
+			struct ring {
+				explicit ring(std::size_t c) : capacity(c), mask(c - 1), slots(new std::atomic<T*>[c]) {}
+				T* get(std::int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+				void put(std::int64_t i, T* x) { slots[i & mask].store(x, std::memory_order_relaxed); }
+				const std::size_t capacity;
+				const std::size_t mask;
+				std::unique_ptr<std::atomic<T*>[]> slots;
+			};
+
+			ring* grow(ring* a, std::int64_t t, std::int64_t b) {
+				ring* bigger = new ring(a->capacity * 2);
+				for(std::int64_t i = t; i < b; ++i) bigger->put(i, a->get(i));
+				// thieves may still be reading from the old ring, keep it alive as long as the deque
+				retired.emplace_back(a);
+				buffer.store(bigger, std::memory_order_release);
+				return bigger;
+			}
+
+			std::atomic<std::int64_t> top;
+			char padding[64];
+			std::atomic<std::int64_t> bottom;
+			std::atomic<ring*> buffer;
+			std::vector<std::unique_ptr<ring>> retired;
+		};
+	}
+
+	class stealing_pool : public thread_pool {
+	public:
+		// a split depth of 0 always spawns, otherwise tasks are spawned lazily as described above
+		explicit stealing_pool(unsigned num_workers, const std::vector<unsigned>& cpus = std::vector<unsigned>(), unsigned depth = 0)
+			: split_depth(depth), external_calls(0), injected(0) {
+			for(unsigned i = 0; i < num_workers; ++i) slots.emplace_back(new worker_slot(i));
+			start(num_workers, cpus);
+		}
+		~stealing_pool() { stop(); }
+
+		std::string name() const override { return split_depth > 0 ? "adaptive" : "stealing"; }
+
+		void submit(detail::task_base* t) override {
+			if(split_depth > 0) {
+				if(current_pool() == this) {
+					worker_slot& self = *slots[worker_index()];
+					increment(self.calls);
+					if(self.tasks.size() >= split_depth && idle_workers() == 0) {
+						increment(self.inlined);
+						t->execute();
+						return;
+					}
+				}
+				else {
+					external_calls.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			thread_pool::submit(t);
+		}
+
+		GranularityStats granularity() const override {
+			GranularityStats stats = { external_calls.load(), 0 };
+			for(const auto& s : slots) {
+				stats.calls += s->calls.load();
+				stats.inlined += s->inlined.load();
+			}
+			return stats;
+		}
+
+		// may only be called while no tasks are running
+		void reset_granularity() override {
+			external_calls.store(0);
+			for(const auto& s : slots) {
+				s->calls.store(0);
+				s->inlined.store(0);
+			}
+		}
+
+	protected:
+		void push(detail::task_base* t) override {
+			if(current_pool() == this) {
+				slots[worker_index()]->tasks.push(t);
+				return;
+			}
+			std::lock_guard<std::mutex> lock(injection_mutex);
+			injection.push_back(t);
+			injected.store(injection.size());
+		}
+
+		detail::task_base* pop(unsigned id, bool) override {
+			worker_slot& self = *slots[id];
+			detail::task_base* t = self.tasks.pop();
+			if(t) return t;
+			t = take_injected();
+			if(t) return t;
+			const unsigned n = static_cast<unsigned>(slots.size());
+			for(unsigned attempt = 1; attempt < n; ++attempt) {
+				unsigned victim = self.next_random() % (n - 1);
+				if(victim >= id) ++victim;
+				t = slots[victim]->tasks.steal();
+				if(t) return t;
+			}
+			return nullptr;
+		}
+
+		bool has_work() const override {
+			if(injected.load() > 0) return true;
+			for(const auto& s : slots) {
+				if(!s->tasks.empty()) return true;
+			}
+			return false;
+		}
+
+	private:
+		struct worker_slot {
+			explicit worker_slot(unsigned id) : seed(2654435761u * (id + 1)), calls(0), inlined(0) {}
+			// xorshift32
+			std::uint32_t next_random() {
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				return seed;
+			}
+			detail::chase_lev_deque<detail::task_base> tasks;
+			std::uint32_t seed;
+			// only written by the owner, atomic so that they can be read from outside the pool
+			std::atomic<unsigned long long> calls;
+			std::atomic<unsigned long long> inlined;
+			char padding[64];
+		};
+
+		static void increment(std::atomic<unsigned long long>& counter) {
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		detail::task_base* take_injected() {
+			if(injected.load(std::memory_order_relaxed) == 0) return nullptr;
+			std::lock_guard<std::mutex> lock(injection_mutex);
+			if(injection.empty()) return nullptr;
+			detail::task_base* t = injection.front();
+			injection.pop_front();
+			injected.store(injection.size());
+			return t;
+		}
+
+		const unsigned split_depth;
+		std::atomic<unsigned long long> external_calls;
+		std::vector<std::unique_ptr<worker_slot>> slots;
+		std::mutex injection_mutex;
+		std::deque<detail::task_base*> injection;
+		std::atomic<std::size_t> injected;
+	};
+}
@@ -531,7 +531,7 @@ void handleCell(const std::launch l, Cell* a) {
 	unlockAll(*aLock, *bLock, *xLock, *yLock, *zLock, *wLock);
 	/*std::cout << "unlocked on " << a << ", " << b << " locks: " <<  *(int*)&a->getLock() << " / " <<  *(int*)&b->getLock() << std::endl;*/  
 
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 	for(Cell* c : newTasks) futures.push_back(inncabs::async(l, &handleCell, l, c));
 	for(auto& f : futures) f.wait();
 }
@@ -543,7 +543,7 @@ void compute(const std::launch l, Cell* net) {
 	set<const Cell*> cells = getClosure(net);
 
 	// step 2: get all connected principle ports
-	std::vector<std::future<void>> cuts;
+	std::vector<inncabs::future<void>> cuts;
 	for(const Cell* cur : cells) {
 		const Port& port = cur->getPrinciplePort();
 		if(cur < port.cell && isCut(cur, port.cell)) {
@@ -567,7 +567,7 @@ void compute(const std::launch l, Cell* net) {
 }
 
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(intersim) {
 	int N = 500;
 	if(argc > 1) N = std::stoi(argv[1]);
 
@@ -588,6 +588,4 @@ int main(int argc, char** argv) {
 		ss.str(),
 		[&]{ n = end(mul(toNet(N), toNet(N))); }
 		);
-
-	return 0;
 }
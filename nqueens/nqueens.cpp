@@ -3,6 +3,9 @@
 typedef long long ll;
 typedef std::vector<int> history;
 
+// columns from this one on are searched sequentially by the task reaching them
+static int arg_spawn_depth = 0;
+
 bool valid(const int n, const int col, const history& h) {
 	if(col==0) return true;
 	int row = h[col-1];
@@ -17,30 +20,203 @@ bool valid(const int n, const int col, const history& h) {
 ll solutions(const int n, const std::launch l, const int col = 0, history h = history()) {
 	if(col == n) {
 		return 1;
+	} else if(col >= arg_spawn_depth) {
+		ll sum = 0;
+		for(int row=0; row<n; ++row) {
+			history x = h;
+			x.push_back(row);
+			if(valid(n, col+1, x)) sum += solutions(n, l, col+1, x);
+		}
+		return sum;
 	} else {
-		std::vector<std::future<ll>> futures;
+		std::vector<inncabs::future<ll>> futures;
 		for(int row=0; row<n; ++row) {
 			history x = h;
 			x.push_back(row);
-			if(valid(n, col+1, x)) futures.push_back(std::async(l, solutions, n, l, col+1, x));
+			if(valid(n, col+1, x)) futures.push_back(inncabs::async(l, solutions, n, l, col+1, x));
 		}
 		return accumulate(futures.begin(), futures.end(), 0ll,
-			[](ll sum, std::future<ll>& b) { return sum + b.get(); });
+			[](ll sum, inncabs::future<ll>& b) { return sum + b.get(); });
+	}
+}
+
+#ifdef INNCABS_COROUTINES
+inncabs::coro::task<ll> solutions_coro(const int n, const int col = 0, history h = history()) {
+	if(col == n) co_return 1;
+	if(col >= arg_spawn_depth) co_return solutions(n, std::launch::deferred, col, h);
+	std::vector<inncabs::coro::task<ll>> tasks;
+	for(int row=0; row<n; ++row) {
+		history x = h;
+		x.push_back(row);
+		if(valid(n, col+1, x)) tasks.push_back(inncabs::coro::spawn(solutions_coro(n, col+1, x)));
+	}
+	ll sum = 0;
+	for(auto& t : tasks) sum += co_await t;
+	co_return sum;
+}
+#endif
+
+// bitboard variant: bit r of a mask is set if row r is attacked in the current column, by a queen
+// in the same row or on one of the two diagonals through it, all passed by value instead of a history
+static const int MAX_N = 32;
+
+typedef unsigned board;
+
+board all_rows(const int n) {
+	return n >= MAX_N ? ~0u : (1u << n) - 1;
+}
+
+ll solutions_bits_seq(const board all, const board rows, const board up, const board down) {
+	if(rows == all) return 1;
+	ll sum = 0;
+	for(board free = all & ~(rows | up | down); free != 0; free &= free - 1) {
+		const board bit = free & (~free + 1);
+		sum += solutions_bits_seq(all, rows | bit, (up | bit) << 1, (down | bit) >> 1);
+	}
+	return sum;
+}
+
+ll solutions_bits(const int n, const std::launch l, const int col = 0, const board rows = 0, const board up = 0, const board down = 0) {
+	const board all = all_rows(n);
+	if(rows == all) return 1;
+	if(col >= arg_spawn_depth) return solutions_bits_seq(all, rows, up, down);
+	inncabs::future<ll> futures[MAX_N];
+	int spawned = 0;
+	for(board free = all & ~(rows | up | down); free != 0; free &= free - 1) {
+		const board bit = free & (~free + 1);
+		futures[spawned++] = inncabs::async(l, solutions_bits, n, l, col + 1, rows | bit, (up | bit) << 1, (down | bit) >> 1);
+	}
+	ll sum = 0;
+	for(int i = 0; i < spawned; ++i) sum += futures[i].get();
+	return sum;
+}
+
+#ifdef INNCABS_COROUTINES
+inncabs::coro::task<ll> solutions_bits_coro(const int n, const int col = 0, const board rows = 0, const board up = 0, const board down = 0) {
+	const board all = all_rows(n);
+	if(rows == all) co_return 1;
+	if(col >= arg_spawn_depth) co_return solutions_bits_seq(all, rows, up, down);
+	inncabs::coro::task<ll> tasks[MAX_N];
+	int spawned = 0;
+	for(board free = all & ~(rows | up | down); free != 0; free &= free - 1) {
+		const board bit = free & (~free + 1);
+		tasks[spawned++] = inncabs::coro::spawn(solutions_bits_coro(n, col + 1, rows | bit, (up | bit) << 1, (down | bit) >> 1));
+	}
+	ll sum = 0;
+	for(int i = 0; i < spawned; ++i) sum += co_await tasks[i];
+	co_return sum;
+}
+#endif
+
+// solutions with the queen of the first column in the given row
+ll subtree(const int n, const std::launch l, const int row, const bool bits) {
+	if(bits) {
+		const board bit = 1u << row;
+		return solutions_bits(n, l, 1, bit, bit << 1, bit >> 1);
+	}
+	return solutions(n, l, 1, history(1, row));
+}
+
+// a solution mirrored vertically is a distinct solution with the first queen in the mirrored row,
+// so only the upper half of the first column is searched and its counts are doubled, except for the
+// middle row of an odd N, which is its own mirror image
+ll mirror_weight(const int n, const int row) {
+	return n % 2 == 1 && row == n / 2 ? 1 : 2;
+}
+
+ll solutions_mirrored(const int n, const std::launch l, const bool bits) {
+	const int rows = (n + 1) / 2;
+	ll sum = 0;
+	if(arg_spawn_depth == 0) {
+		for(int row = 0; row < rows; ++row) sum += mirror_weight(n, row) * subtree(n, l, row, bits);
+		return sum;
+	}
+	std::vector<inncabs::future<ll>> futures;
+	for(int row = 0; row < rows; ++row) futures.push_back(inncabs::async(l, subtree, n, l, row, bits));
+	for(int row = 0; row < rows; ++row) sum += mirror_weight(n, row) * futures[row].get();
+	return sum;
+}
+
+#ifdef INNCABS_COROUTINES
+inncabs::coro::task<ll> subtree_coro(const int n, const int row, const bool bits) {
+	if(bits) {
+		const board bit = 1u << row;
+		co_return co_await solutions_bits_coro(n, 1, bit, bit << 1, bit >> 1);
+	}
+	co_return co_await solutions_coro(n, 1, history(1, row));
+}
+
+inncabs::coro::task<ll> solutions_mirrored_coro(const int n, const bool bits) {
+	const int rows = (n + 1) / 2;
+	std::vector<inncabs::coro::task<ll>> tasks;
+	for(int row = 0; row < rows; ++row) {
+		if(arg_spawn_depth == 0) tasks.push_back(subtree_coro(n, row, bits));
+		else tasks.push_back(inncabs::coro::spawn(subtree_coro(n, row, bits)));
 	}
+	ll sum = 0;
+	for(int row = 0; row < rows; ++row) sum += mirror_weight(n, row) * co_await tasks[row];
+	co_return sum;
 }
+#endif
 
-static const ll CHECK[] = { 1,0,0,2,10,4,40,92,352,724,2680,14200,73712,365596,2279184,14772512,95815104,666090624,4968057848,39029188884,314666222712 };
+// number of solutions for N=1 to 27, all of which fit into 64 bits
+static const ll CHECK[] = { 1,0,0,2,10,4,40,92,352,724,2680,14200,73712,365596,2279184,14772512,95815104,666090624,4968057848,39029188884,314666222712,
+	2691008701644,24233937684440,227514171973736,2207893435808352,22317699616364044,234907967154122528 };
+static const int CHECK_N = sizeof(CHECK) / sizeof(CHECK[0]);
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(nqueens) {
 	int n = 8;
 	if(argc > 1) n = atoi(argv[1]);
+	std::string variant = "vector";
+	if(argc > 2) variant = argv[2];
+	if(variant != "vector" && variant != "bitboard") {
+		inncabs::error("Error: unknown variant " + variant + ", expected vector or bitboard\n");
+	}
+	const bool bits = variant == "bitboard";
+	arg_spawn_depth = n;
+	if(argc > 3) arg_spawn_depth = std::max(0, std::min(n, atoi(argv[3])));
+	bool mirrored = false;
+	if(argc > 4) mirrored = std::string(argv[4]) == "mirror";
+	if(n < 1 || n > CHECK_N) {
+		inncabs::error("Error: N has to be between 1 and " + std::to_string(CHECK_N) + ", the largest N with a known number of solutions\n");
+	}
+	if(bits && n > MAX_N) {
+		inncabs::error("Error: the bitboard variant supports at most N=" + std::to_string(MAX_N) + "\n");
+	}
 
 	std::stringstream ss;
 	ss << "N-Queens N=" << n;
+	if(bits) ss << " (bitboard)";
+	if(arg_spawn_depth < n) ss << " spawn depth " << arg_spawn_depth;
+	if(mirrored) ss << " mirrored";
 
-	inncabs::run_all(
-		[n](const std::launch l) { return solutions(n, l); },
-		[n](ll result) { return result == CHECK[n-1]; },
-		ss.str() 
-		);
+	if(inncabs::service::requested()) {
+		// request k counts the solutions with the queen of the first column in row k % n
+		std::vector<ll> subtree_check;
+		for(int row = 0; row < n; ++row) subtree_check.push_back(subtree(n, std::launch::deferred, row, bits));
+		inncabs::serve(
+			[n, bits](const std::launch l, unsigned long long k) { return subtree(n, l, static_cast<int>(k % n), bits); },
+			[n, subtree_check](unsigned long long k, ll result) { return result == subtree_check[k % n]; },
+			ss.str()
+			);
+	}
+	else {
+#ifdef INNCABS_COROUTINES
+		inncabs::coro::declare_variant();
+#endif
+		inncabs::run_all(
+			[n, bits, mirrored](const std::launch l) {
+#ifdef INNCABS_COROUTINES
+				if(l == inncabs::launch::coroutine) {
+					if(mirrored) return inncabs::coro::run(solutions_mirrored_coro(n, bits));
+					return inncabs::coro::run(bits ? solutions_bits_coro(n) : solutions_coro(n));
+				}
+#endif
+				if(mirrored) return solutions_mirrored(n, l, bits);
+				return bits ? solutions_bits(n, l) : solutions(n, l);
+			},
+			[n](ll result) { return result == CHECK[n-1]; },
+			ss.str()
+			);
+	}
 }
@@ -2,11 +2,11 @@
 
 #include "pyramids.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(pyramids) {
 
-	// allocate two copies of the processed array
-	Grid* A = (Grid*)malloc(sizeof(Grid));
-	Grid* B = (Grid*)malloc(sizeof(Grid));
+	// allocate two copies of the processed array, placed according to INNCABS_NUMA
+	Grid* A = (Grid*)inncabs::numa::alloc(sizeof(Grid));
+	Grid* B = (Grid*)inncabs::numa::alloc(sizeof(Grid));
 	
 	std::stringstream ss;
 	ss << "Cache-oblivious Jacobi Solver (P = " << P << " = " << N << " x " << M << "; CUT = " << CUT << ")";
@@ -22,4 +22,7 @@ int main(int argc, char** argv) {
 		ss.str(),
 		[&] { jacobi_init(A); }
 		);
+
+	inncabs::numa::free(A, sizeof(Grid));
+	inncabs::numa::free(B, sizeof(Grid));
 }
@@ -195,13 +195,13 @@ void compute_pyramid(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute 4 base-pyramids (parallel)
 	// #pragma omp task
-	std::future<void> f1 = std::async(l, compute_pyramid, l, A, B, ux, uy,  d);
+	inncabs::future<void> f1 = inncabs::async(l, compute_pyramid, l, A, B, ux, uy,  d);
 	// #pragma omp task
-	std::future<void> f2 = std::async(l, compute_pyramid, l, A, B, ux, ly,  d);
+	inncabs::future<void> f2 = inncabs::async(l, compute_pyramid, l, A, B, ux, ly,  d);
 	// #pragma omp task
-	std::future<void> f3 = std::async(l, compute_pyramid, l, A, B, lx, uy,  d);
+	inncabs::future<void> f3 = inncabs::async(l, compute_pyramid, l, A, B, lx, uy,  d);
 	// #pragma omp task
-	std::future<void> f4 = std::async(l, compute_pyramid, l, A, B, lx, ly,  d);
+	inncabs::future<void> f4 = inncabs::async(l, compute_pyramid, l, A, B, lx, ly,  d);
 
 	// #pragma omp taskwait
 	f1.wait();
@@ -211,13 +211,13 @@ void compute_pyramid(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute 4 wedges (parallel)
 	// #pragma omp task
-	f1 = std::async(l, compute_wedge_x, l, A, B, ux, y, d);
+	f1 = inncabs::async(l, compute_wedge_x, l, A, B, ux, y, d);
 	// #pragma omp task
-	f2 = std::async(l, compute_wedge_x, l, A, B, lx, y, d);
+	f2 = inncabs::async(l, compute_wedge_x, l, A, B, lx, y, d);
 	// #pragma omp task
-	f3 = std::async(l, compute_wedge_y, l, A, B, x, uy, d);
+	f3 = inncabs::async(l, compute_wedge_y, l, A, B, x, uy, d);
 	// #pragma omp task
-	f4 = std::async(l, compute_wedge_y, l, A, B, x, ly, d);
+	f4 = inncabs::async(l, compute_wedge_y, l, A, B, x, ly, d);
 
 	// #pragma omp taskwait
 	f1.wait();
@@ -285,13 +285,13 @@ void compute_reverse(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute 4 wedges (parallel)
 	// #pragma omp task
-	std::future<void> f1 = std::async(l, compute_wedge_y, l, A, B, ux, y, d);
+	inncabs::future<void> f1 = inncabs::async(l, compute_wedge_y, l, A, B, ux, y, d);
 	// #pragma omp task
-	std::future<void> f2 = std::async(l, compute_wedge_y, l, A, B, lx, y, d);
+	inncabs::future<void> f2 = inncabs::async(l, compute_wedge_y, l, A, B, lx, y, d);
 	// #pragma omp task
-	std::future<void> f3 = std::async(l, compute_wedge_x, l, A, B, x, uy,  d);
+	inncabs::future<void> f3 = inncabs::async(l, compute_wedge_x, l, A, B, x, uy,  d);
 	// #pragma omp task
-	std::future<void> f4 = std::async(l, compute_wedge_x, l, A, B, x, ly, d);
+	inncabs::future<void> f4 = inncabs::async(l, compute_wedge_x, l, A, B, x, ly, d);
 
 	// #pragma omp taskwait
 	f1.wait();
@@ -301,13 +301,13 @@ void compute_reverse(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute 4 base-pyramids (parallel)
 	// #pragma omp task
-	f1 = std::async(l, compute_reverse, l, A, B, lx, ly,  d);
+	f1 = inncabs::async(l, compute_reverse, l, A, B, lx, ly,  d);
 	// #pragma omp task
-	f2 = std::async(l, compute_reverse, l, A, B, lx, uy,  d);
+	f2 = inncabs::async(l, compute_reverse, l, A, B, lx, uy,  d);
 	// #pragma omp task
-	f3 = std::async(l, compute_reverse, l, A, B, ux, ly,  d);
+	f3 = inncabs::async(l, compute_reverse, l, A, B, ux, ly,  d);
 	// #pragma omp task
-	f4 = std::async(l, compute_reverse, l, A, B, ux, uy,  d);
+	f4 = inncabs::async(l, compute_reverse, l, A, B, ux, uy,  d);
 
 	// #pragma omp taskwait
 	f1.wait();
@@ -354,9 +354,9 @@ void compute_wedge_x(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute bottom wedges (parallel)
 	// #pragma omp task
-	std::future<void> f1 = std::async(l, compute_wedge_x, l, A, B, x-h, y, d);
+	inncabs::future<void> f1 = inncabs::async(l, compute_wedge_x, l, A, B, x-h, y, d);
 	// #pragma omp task
-	std::future<void> f2 = std::async(l, compute_wedge_x, l, A, B, x+h, y, d);
+	inncabs::future<void> f2 = inncabs::async(l, compute_wedge_x, l, A, B, x+h, y, d);
 	// #pragma omp taskwait
 	f1.wait();
 	f2.wait();
@@ -369,9 +369,9 @@ void compute_wedge_x(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute remaining two wedges (parallel)
 	// #pragma omp task
-	f1 = std::async(l, compute_wedge_x, l, A, B, x, y-h, d);
+	f1 = inncabs::async(l, compute_wedge_x, l, A, B, x, y-h, d);
 	// #pragma omp task
-	f2 = std::async(l, compute_wedge_x, l, A, B, x, y+h, d);
+	f2 = inncabs::async(l, compute_wedge_x, l, A, B, x, y+h, d);
 	// #pragma omp taskwait
 	f1.wait();
 	f2.wait();
@@ -415,9 +415,9 @@ void compute_wedge_y(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute bottom wedges (parallel)
 	// #pragma omp task
-	std::future<void> f1 = std::async(l, compute_wedge_y, l, A, B, x, y-h, d);
+	inncabs::future<void> f1 = inncabs::async(l, compute_wedge_y, l, A, B, x, y-h, d);
 	// #pragma omp task
-	std::future<void> f2 = std::async(l, compute_wedge_y, l, A, B, x, y+h, d);
+	inncabs::future<void> f2 = inncabs::async(l, compute_wedge_y, l, A, B, x, y+h, d);
 	// #pragma omp taskwait
 	f1.wait();
 	f2.wait();
@@ -430,9 +430,9 @@ void compute_wedge_y(const std::launch l, Grid* A, Grid* B, int x, int y, int s)
 
 	// compute remaining two wedges (parallel)
 	// #pragma omp task
-	f1 = std::async(l, compute_wedge_y, l, A, B, x-h, y, d);
+	f1 = inncabs::async(l, compute_wedge_y, l, A, B, x-h, y, d);
 	// #pragma omp task
-	f2 = std::async(l, compute_wedge_y, l, A, B, x+h, y, d);
+	f2 = inncabs::async(l, compute_wedge_y, l, A, B, x+h, y, d);
 	// #pragma omp taskwait
 	f1.wait();
 	f2.wait();
@@ -2,7 +2,7 @@
 
 #include "qap.h"
 
-int main(int argc, char** argv) {	
+INNCABS_MAIN(qap) {	
 	const char* problem_file = argc>1 ? argv[1] : "input/qap/chr10a.dat";
 
 	// load problem
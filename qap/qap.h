@@ -64,12 +64,12 @@ int solve_rec(const std::launch l, problem* problem, solution* partial, int plan
 		return best_known;
 	}
 
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 
 	// fix current position
 	for(int i=0; i<problem->size; i++) {
 		// check whether current spot is a free spot
-		futures.push_back(std::async(l, [=, &best_known]() {
+		futures.push_back(inncabs::async(l, [=, &best_known]() {
 			if(!(1<<i & used_mask)) {
 				// extend solution
 				solution tmp = {partial, i};
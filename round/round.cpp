@@ -62,7 +62,7 @@ std::chrono::milliseconds Philosopher::get_eat_duration() {
     return std::min(std::chrono::milliseconds(ms(eng_)), full - eat_time_);
 }
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(round) {
 	unsigned n = 16;
 	if(argc>1) n = std::atoi(argv[1]);
 	Philosopher::full = std::chrono::milliseconds(50);
@@ -76,9 +76,9 @@ int main(int argc, char** argv) {
 
 	inncabs::run_all(
 		[&](const std::launch l) {
-			std::vector<std::future<void>> futures;
+			std::vector<inncabs::future<void>> futures;
 			for(auto& d : diners) {
-				futures.push_back(std::async(l, [&] { d.dine(); }));
+				futures.push_back(inncabs::async(l, [&] { d.dine(); }));
 			}
 			for(auto& f : futures) {
 				f.wait();
@@ -1,3 +1,4 @@
+require 'json'
 require './color.rb'
 require './os.rb'
 
@@ -15,9 +16,19 @@ end
 min_cpus = read_int_param("--min-cpus", 1)
 max_cpus = read_int_param("--max-cpus", 8)
 repeats = read_int_param("--repeats", 5)
+warmup = read_int_param("--warmup", 0)
 timeout_secs = read_int_param("--timeout", 100)
+bin_dir = "bin"
+if(ARGV.include?("--bin"))
+	idx = ARGV.index("--bin")
+	bin_dir = ARGV[idx+1]
+	ARGV.delete_at(idx)
+	ARGV.delete_at(idx)
+end
+driver = ARGV.include?("--driver")
+ARGV.delete("--driver")
 
-launch_types = %w(deferred optional async)
+launch_types = %w(deferred optional async pool stealing adaptive)
 
 params = {
 	"alignment" => "bin/input/alignment/prot.100.aa",
@@ -47,50 +58,105 @@ win_cpu_aff = {
 }
 
 results = Hash.new { |h,k| h[k] = Hash.new { |h,k| h[k] = Hash.new { |h,k| h[k] = Array.new(2) } } } 
+json_results = []
+
+def store_results(results, json_results)
+	File.open("results.rb","w+") do |f|
+		f.puts "results = " + results.inspect
+	end
+	File.open("results.json","w+") do |f|
+		f.puts JSON.pretty_generate(json_results)
+	end
+end
+
+# stores the results of a core count sweep of one benchmark, run is nil if it did not finish
+def record_sweep(results, json_results, fname, launch_type, counts, run)
+	if(run && !run["results"].empty?)
+		run["results"].each do |res|
+			results[fname][launch_type][res["threads"]][0] = res["summary"]["median_ms"]
+			results[fname][launch_type][res["threads"]][1] = res["summary"]["stddev_ms"]
+		end
+		puts run["results"].map { |res| "#{res["threads"]}: #{res["summary"]["median_ms"]},#{res["summary"]["stddev_ms"]}" }.join("; ").bold
+		json_results << run
+	else
+		puts "timeout".bold
+		counts.each do |num_cpus|
+			results[fname][launch_type][num_cpus][0] = 0
+			results[fname][launch_type][num_cpus][1] = 0
+		end
+	end
+	store_results(results, json_results)
+end
+
+cpu_counts = []
+num_cpus = min_cpus
+while(num_cpus <= max_cpus)
+	cpu_counts << num_cpus
+	num_cpus *= 2
+end
 
-Dir["**/*.cpp"].each do |cppfile|
-	next if !ARGV.empty? && !ARGV.any? { |arg| cppfile =~ /#{arg}/ }
-	num_cpus = min_cpus
+benchmarks = Dir["**/*.cpp"].reject { |cppfile| cppfile.start_with?("driver/") }
+benchmarks = benchmarks.select { |cppfile| ARGV.empty? || ARGV.any? { |arg| cppfile =~ /#{arg}/ } }
+
+if(driver && !OS.windows?)
+	# a single process of the driver binary runs all benchmarks per launch type, sharing its thread pools
+	names = benchmarks.map { |cppfile| File.basename(cppfile, ".cpp") }
+	invocation = names.map { |fname| params.include?(fname) ? "#{fname} #{params[fname]}" : fname }.join(" -- ")
 	launch_types.each do |launch_type|
-		num_cpus = min_cpus
-		while(num_cpus <= max_cpus)
-			if(launch_type == "deferred" && num_cpus > min_cpus)
-				num_cpus *= 2
-				next
-			end
-			fname = File.basename(cppfile, ".cpp")
-			binfname =  "bin/" + fname
-			cpulist = (0..num_cpus-1).to_a.join(",")
-			if(OS.windows?)
-				command  = "set INNCABS_REPEATS=#{repeats}\nset INNCABS_MIN_OUTPUT=true\n"
+		counts = launch_type == "deferred" ? [min_cpus] : cpu_counts
+		command  = "export INNCABS_REPEATS=#{repeats}\nexport INNCABS_WARMUP=#{warmup}\nexport INNCABS_JSON_OUTPUT=true\n"
+		command += "export INNCABS_LAUNCH_TYPES=#{launch_type}\nexport INNCABS_THREADS=#{counts.join(",")}\n"
+		command += "ulimit -t #{timeout_secs*counts.sum*names.size}\n"
+		command += "timeout #{timeout_secs*counts.size*names.size} #{bin_dir}/inncabs #{invocation}"
+		puts "======== Running " + names.join(", ").green.bold + " (#{launch_type}, #{counts.join(",")})"
+		runs = JSON.parse(`#{command}`) rescue nil
+		names.each_with_index do |fname, i|
+			print "======== " + fname.green.bold + " (#{launch_type}): "
+			record_sweep(results, json_results, fname, launch_type, counts, runs && runs[i])
+		end
+	end
+	exit
+end
+
+benchmarks.each do |cppfile|
+	fname = File.basename(cppfile, ".cpp")
+	binfname =  bin_dir + "/" + fname
+	launch_types.each do |launch_type|
+		if(OS.windows?)
+			# std::async threads on Windows do not inherit the affinity of their creator, so each core count is a separate process
+			cpu_counts.each do |num_cpus|
+				next if launch_type == "deferred" && num_cpus > min_cpus
+				command  = "set INNCABS_REPEATS=#{repeats}\nset INNCABS_WARMUP=#{warmup}\nset INNCABS_JSON_OUTPUT=true\n"
 				command += "set INNCABS_LAUNCH_TYPES=#{launch_type}\nset INNCABS_TIMEOUT=#{timeout_secs*1000}\n"
 				command += "start #{win_cpu_aff[num_cpus]} /B /WAIT #{binfname}"
-			else
-				command = "timeout #{timeout_secs} taskset -c #{cpulist} #{binfname}"
-				command = "export INNCABS_REPEATS=#{repeats}\nexport INNCABS_MIN_OUTPUT=true\nexport INNCABS_LAUNCH_TYPES=#{launch_type}\n" + command
-				command = "ulimit -t #{timeout_secs*num_cpus}\n" + command
-			end
-			command += " " + params[fname] if params.include?(fname)
-			print "======== Running " + fname.green.bold + " (#{launch_type}, #{num_cpus}): " 
-			#puts command
-			if(OS.windows?)
+				command += " " + params[fname] if params.include?(fname)
+				print "======== Running " + fname.green.bold + " (#{launch_type}, #{num_cpus}): " 
 				File.open("run.bat", "w+") { |f| f.puts command }
-				command = "run.bat"
+				run = JSON.parse(`run.bat`) rescue nil
+				if(run && !run["results"].empty?)
+					summary = run["results"][0]["summary"]
+					puts "#{summary["median_ms"]},#{summary["stddev_ms"]}".bold
+					results[fname][launch_type][num_cpus][0] = summary["median_ms"]
+					results[fname][launch_type][num_cpus][1] = summary["stddev_ms"]
+					json_results << run.merge("num_cpus" => num_cpus)
+				else
+					puts "timeout".bold
+					results[fname][launch_type][num_cpus][0] = 0
+					results[fname][launch_type][num_cpus][1] = 0
+				end
+				store_results(results, json_results)
 			end
-			result = `#{command}`
-			if(result =~ /(\d+(?:\.\d+)?),(\d+(?:\.\d+)?)/)
-				puts result.strip.bold
-				results[fname][launch_type][num_cpus][0] = $1.to_f
-				results[fname][launch_type][num_cpus][1] = $2.to_f
-			else
-				puts "timeout".bold
-				results[fname][launch_type][num_cpus][0] = 0
-				results[fname][launch_type][num_cpus][1] = 0
-			end
-			File.open("results.rb","w+") do |f|
-				f.puts "results = " + results.inspect
-			end
-			num_cpus *= 2
+		else
+			# a single process sweeps all core counts, pinning its threads itself
+			counts = launch_type == "deferred" ? [min_cpus] : cpu_counts
+			command  = "export INNCABS_REPEATS=#{repeats}\nexport INNCABS_WARMUP=#{warmup}\nexport INNCABS_JSON_OUTPUT=true\n"
+			command += "export INNCABS_LAUNCH_TYPES=#{launch_type}\nexport INNCABS_THREADS=#{counts.join(",")}\n"
+			command += "ulimit -t #{timeout_secs*counts.sum}\n"
+			command += "timeout #{timeout_secs*counts.size} #{binfname}"
+			command += " " + params[fname] if params.include?(fname)
+			print "======== Running " + fname.green.bold + " (#{launch_type}, #{counts.join(",")}): " 
+			run = JSON.parse(`#{command}`) rescue nil
+			record_sweep(results, json_results, fname, launch_type, counts, run)
 		end
 	end
 end
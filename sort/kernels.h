@@ -0,0 +1,209 @@
+#pragma once
+
+/*
+* Leaf kernels of cilksort, selected at runtime.
+*
+* The libc kernel sorts leaves with qsort and merges with the branchy seqmerge
+* loop of the original code. The network kernels sort a leaf in two steps:
+*
+*   1) blocks of 8 x lanes elements are loaded as 8 vectors of `lanes' elements
+*      each, and an optimal 19 comparator sorting network for 8 inputs is
+*      applied to the vectors with vector min/max, sorting each lane. The
+*      sorted lanes are transposed into runs of 8 elements in the leaf's part
+*      of the temporary array.
+*   2) the runs are merged bottom-up, alternating between the two arrays, with
+*      a branchless merge which selects the next element and advances both
+*      inputs arithmetically instead of branching on the comparison.
+*
+* Merges below cutoff 1 use the same branchless merge. The vector networks
+* exist for SSE 4.2 and AVX2 and for 32-bit and 64-bit integers and doubles in
+* ascending order, all other element types and comparators use the scalar
+* network, which compares and exchanges single elements without branches.
+* The vector kernels are compiled with function-level target attributes and
+* are only available on x86 with GCC or Clang; whether the CPU supports them
+* is checked at runtime.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SORT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+enum class sort_kernel { libc, scalar, sse, avx2 };
+
+inline std::string kernel_name(const sort_kernel k) {
+	switch(k) {
+		case sort_kernel::libc: return "qsort";
+		case sort_kernel::scalar: return "scalar";
+		case sort_kernel::sse: return "sse";
+		case sort_kernel::avx2: return "avx2";
+	}
+	return "unknown";
+}
+
+inline bool kernel_supported(const sort_kernel k) {
+#ifdef SORT_SIMD_X86
+	if(k == sort_kernel::avx2) return __builtin_cpu_supports("avx2");
+	if(k == sort_kernel::sse) return __builtin_cpu_supports("sse4.2");
+	return true;
+#else
+	return k == sort_kernel::libc || k == sort_kernel::scalar;
+#endif
+}
+
+// the fastest network kernel supported by this CPU
+inline sort_kernel best_kernel() {
+	if(kernel_supported(sort_kernel::avx2)) return sort_kernel::avx2;
+	if(kernel_supported(sort_kernel::sse)) return sort_kernel::sse;
+	return sort_kernel::scalar;
+}
+
+// applies the sorting network for 8 inputs, with CE(X, Y, a, b) ordering inputs a < b
+#define SORT_NETWORK_8(CE, X, Y) \
+	CE(X, Y, 0, 2) CE(X, Y, 1, 3) CE(X, Y, 4, 6) CE(X, Y, 5, 7) \
+	CE(X, Y, 0, 4) CE(X, Y, 1, 5) CE(X, Y, 2, 6) CE(X, Y, 3, 7) \
+	CE(X, Y, 0, 1) CE(X, Y, 2, 3) CE(X, Y, 4, 5) CE(X, Y, 6, 7) \
+	CE(X, Y, 2, 4) CE(X, Y, 3, 5) \
+	CE(X, Y, 1, 4) CE(X, Y, 3, 6) \
+	CE(X, Y, 1, 2) CE(X, Y, 3, 4) CE(X, Y, 5, 6)
+
+// sorts 8 consecutive elements
+template<typename T, typename Compare>
+void sort_columns_scalar(T *block) {
+	const Compare comp;
+	T r[8];
+	for(int i = 0; i < 8; ++i) r[i] = block[i];
+#define SORT_CE_SCALAR(X, Y, a, b) { \
+		const bool swap = comp(r[b], r[a]); \
+		const T lo = swap ? r[b] : r[a]; \
+		r[b] = swap ? r[a] : r[b]; \
+		r[a] = lo; \
+	}
+	SORT_NETWORK_8(SORT_CE_SCALAR, _, _)
+#undef SORT_CE_SCALAR
+	for(int i = 0; i < 8; ++i) block[i] = r[i];
+}
+
+#ifdef SORT_SIMD_X86
+// vector min/max missing from the instruction sets, or differing between element types
+__attribute__((target("sse4.2"))) inline __m128i min_epi64_sse(__m128i a, __m128i b) { return _mm_blendv_epi8(a, b, _mm_cmpgt_epi64(a, b)); }
+__attribute__((target("sse4.2"))) inline __m128i max_epi64_sse(__m128i a, __m128i b) { return _mm_blendv_epi8(b, a, _mm_cmpgt_epi64(a, b)); }
+__attribute__((target("avx2"))) inline __m256i min_epi64_avx2(__m256i a, __m256i b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+__attribute__((target("avx2"))) inline __m256i max_epi64_avx2(__m256i a, __m256i b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+
+// sorts the lanes of 8 consecutive vectors
+#define SORT_COLUMNS_SIMD(NAME, TARGET, T, V, LANES, LOAD, STORE, MIN, MAX) \
+	__attribute__((target(TARGET))) inline void NAME(T *block) { \
+		V r[8]; \
+		for(int i = 0; i < 8; ++i) r[i] = LOAD(block + LANES * i); \
+		SORT_NETWORK_8(SORT_CE_SIMD, MIN, MAX) \
+		for(int i = 0; i < 8; ++i) STORE(block + LANES * i, r[i]); \
+	}
+
+#define SORT_CE_SIMD(MIN, MAX, a, b) { const auto lo = MIN(r[a], r[b]); r[b] = MAX(r[a], r[b]); r[a] = lo; }
+
+#define SORT_LOAD_SI128(p) _mm_loadu_si128((const __m128i*)(p))
+#define SORT_STORE_SI128(p, v) _mm_storeu_si128((__m128i*)(p), v)
+#define SORT_LOAD_SI256(p) _mm256_loadu_si256((const __m256i*)(p))
+#define SORT_STORE_SI256(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+SORT_COLUMNS_SIMD(sort_columns_sse_i32, "sse4.2", std::int32_t, __m128i, 4, SORT_LOAD_SI128, SORT_STORE_SI128, _mm_min_epi32, _mm_max_epi32)
+SORT_COLUMNS_SIMD(sort_columns_sse_i64, "sse4.2", std::int64_t, __m128i, 2, SORT_LOAD_SI128, SORT_STORE_SI128, min_epi64_sse, max_epi64_sse)
+SORT_COLUMNS_SIMD(sort_columns_sse_f64, "sse4.2", double, __m128d, 2, _mm_loadu_pd, _mm_storeu_pd, _mm_min_pd, _mm_max_pd)
+SORT_COLUMNS_SIMD(sort_columns_avx2_i32, "avx2", std::int32_t, __m256i, 8, SORT_LOAD_SI256, SORT_STORE_SI256, _mm256_min_epi32, _mm256_max_epi32)
+SORT_COLUMNS_SIMD(sort_columns_avx2_i64, "avx2", std::int64_t, __m256i, 4, SORT_LOAD_SI256, SORT_STORE_SI256, min_epi64_avx2, max_epi64_avx2)
+SORT_COLUMNS_SIMD(sort_columns_avx2_f64, "avx2", double, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_min_pd, _mm256_max_pd)
+#endif
+
+// column sort of a network kernel, and the number of lanes it sorts
+template<typename T>
+struct network {
+	void (*columns)(T *block);
+	int lanes;
+};
+
+// the scalar network, used for all types without vector networks
+template<typename T, typename Compare>
+struct network_select {
+	static network<T> get(const sort_kernel) {
+		network<T> n = { &sort_columns_scalar<T, Compare>, 1 };
+		return n;
+	}
+};
+
+#ifdef SORT_SIMD_X86
+#define SORT_NETWORK_SELECT(T, SUFFIX) \
+	template<> \
+	struct network_select<T, std::less<T>> { \
+		static network<T> get(const sort_kernel k) { \
+			network<T> n = { &sort_columns_scalar<T, std::less<T>>, 1 }; \
+			if(k == sort_kernel::sse) { n.columns = &sort_columns_sse_##SUFFIX; n.lanes = 16 / sizeof(T); } \
+			if(k == sort_kernel::avx2) { n.columns = &sort_columns_avx2_##SUFFIX; n.lanes = 32 / sizeof(T); } \
+			return n; \
+		} \
+	};
+
+SORT_NETWORK_SELECT(std::int32_t, i32)
+SORT_NETWORK_SELECT(std::int64_t, i64)
+SORT_NETWORK_SELECT(double, f64)
+#endif
+
+// merges [low1, high1) and [low2, high2) into lowdest, without branching on the comparison
+template<typename T, typename Compare>
+void branchless_merge(const T *low1, const T *high1, const T *low2, const T *high2, T *lowdest) {
+	const Compare comp;
+	while(low1 < high1 && low2 < high2) {
+		const bool second = comp(*low2, *low1);
+		*lowdest++ = second ? *low2 : *low1;
+		low1 += !second;
+		low2 += second;
+	}
+	if(low1 < high1) memcpy(lowdest, low1, sizeof(T) * (high1 - low1));
+	if(low2 < high2) memcpy(lowdest, low2, sizeof(T) * (high2 - low2));
+}
+
+template<typename T, typename Compare>
+void insertion_sort(T *low, T *high) {
+	const Compare comp;
+	for(T *i = low + 1; i < high; ++i) {
+		const T val = *i;
+		T *j = i;
+		for(; j > low && comp(val, *(j - 1)); --j) *j = *(j - 1);
+		*j = val;
+	}
+}
+
+// sorts [low, low + size) with a network kernel, using [tmp, tmp + size) as scratch space
+template<typename T, typename Compare>
+void network_sort(const sort_kernel k, T *low, T *tmp, long size) {
+	const network<T> n = network_select<T, Compare>::get(k);
+	const long block = 8 * n.lanes;
+
+	/* sorted lanes are transposed into runs of 8 in tmp, the rest is one more run */
+	long start = 0;
+	for(; start + block <= size; start += block) {
+		n.columns(low + start);
+		for(int lane = 0; lane < n.lanes; ++lane) {
+			for(int row = 0; row < 8; ++row) tmp[start + 8 * lane + row] = low[start + n.lanes * row + lane];
+		}
+	}
+	memcpy(tmp + start, low + start, sizeof(T) * (size - start));
+	insertion_sort<T, Compare>(tmp + start, tmp + size);
+
+	/* bottom-up merge, every width-aligned range of the source is sorted */
+	T *src = tmp, *dest = low;
+	for(long width = 8; width < size; width *= 2) {
+		for(long i = 0; i < size; i += 2 * width) {
+			const long mid = std::min(i + width, size), end = std::min(i + 2 * width, size);
+			branchless_merge<T, Compare>(src + i, src + mid, src + mid, src + end, dest + i);
+		}
+		std::swap(src, dest);
+	}
+	if(src != low) memcpy(low, src, sizeof(T) * size);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+/*
+* Parallel LSD radix sort, an alternative to cilksort without comparisons.
+*
+* Elements are sorted by an unsigned key which preserves their order, one
+* 8-bit digit per pass starting with the least significant one:
+*
+*   for each digit d:
+*       split the source into k chunks, and for each chunk (in parallel)
+*           count the elements with each of the 256 values of d
+*       compute the offset of every (value, chunk) pair by a prefix sum over
+*       the values, and for each value over the chunks
+*       for each chunk (in parallel)
+*           scatter its elements stably to their offsets in the destination
+*       swap source and destination
+*
+* Passes in which all elements have the same digit are skipped, e.g. the high
+* bytes of small 64-bit keys. Each pass streams the whole array twice, so the
+* algorithm is bound by memory bandwidth rather than by comparisons. Chunks
+* are formed like the tasks of samplesort.h.
+*
+* Included by sort.cpp, after samplesort.h.
+*/
+
+#include <cstdint>
+#include <vector>
+
+// order-preserving unsigned keys
+inline std::uint32_t radix_key(std::int32_t e) {
+	return static_cast<std::uint32_t>(e) ^ 0x80000000u;
+}
+
+inline std::uint64_t radix_key(long long e) {
+	return static_cast<std::uint64_t>(e) ^ 0x8000000000000000ull;
+}
+
+inline std::uint64_t radix_key(long e) {
+	return radix_key(static_cast<long long>(e));
+}
+
+inline std::uint64_t radix_key(double e) {
+	std::uint64_t bits;
+	memcpy(&bits, &e, sizeof(bits));
+	/* negative values are ordered by their inverted bits, positive ones after them */
+	return (bits & 0x8000000000000000ull) ? ~bits : bits ^ 0x8000000000000000ull;
+}
+
+inline std::uint64_t radix_key(const record& e) {
+	return e.key;
+}
+
+static const int RADIX_BITS = 8;
+static const long RADIX = 1 << RADIX_BITS;
+
+template<typename T>
+void radixsort_par(const std::launch l, T *low, T *tmp, long size) {
+	typedef decltype(radix_key(*low)) key;
+	const long k = task_count(size);
+	const long chunk = (size + k - 1) / k;
+
+	T *src = low, *dest = tmp;
+	std::vector<long> counts(k * RADIX);
+	std::vector<long> offsets(k * RADIX);
+	for(unsigned shift = 0; shift < sizeof(key) * 8; shift += RADIX_BITS) {
+		auto digit = [shift](const T& e) { return static_cast<long>((radix_key(e) >> shift) & (RADIX - 1)); };
+
+		/* counts[c * RADIX + d] is the number of elements of chunk c with digit d */
+		parallel_tasks(l, k, [&](long c) {
+			long *count = &counts[c * RADIX];
+			std::fill(count, count + RADIX, 0);
+			const long end = std::min(size, (c + 1) * chunk);
+			for(long i = c * chunk; i < end; ++i) ++count[digit(src[i])];
+		});
+
+		long sum = 0;
+		bool skip = false;
+		for(long d = 0; d < RADIX; ++d) {
+			const long start = sum;
+			for(long c = 0; c < k; ++c) {
+				offsets[c * RADIX + d] = sum;
+				sum += counts[c * RADIX + d];
+			}
+			if(sum - start == size) skip = true;
+		}
+		if(skip) continue;
+
+		parallel_tasks(l, k, [&](long c) {
+			long *offset = &offsets[c * RADIX];
+			const long end = std::min(size, (c + 1) * chunk);
+			for(long i = c * chunk; i < end; ++i) dest[offset[digit(src[i])]++] = src[i];
+		});
+		std::swap(src, dest);
+	}
+	if(src != low) {
+		parallel_tasks(l, k, [&](long c) {
+			const long begin = std::min(size, c * chunk), end = std::min(size, (c + 1) * chunk);
+			memcpy(low + begin, src + begin, sizeof(T) * (end - begin));
+		});
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+* Parallel sample sort, an alternative to cilksort with a constant depth.
+*
+*   samplesort(in[1..n]) =
+*       sort a regular sample of in, and pick k-1 splitters from it
+*       split in into k chunks, and for each chunk (in parallel)
+*           count the elements falling into each of the k buckets
+*       compute the offset of every (bucket, chunk) pair by a prefix sum
+*       for each chunk (in parallel)
+*           scatter its elements to their buckets in tmp
+*       for each bucket (in parallel)
+*           sort it with the leaf kernel, and copy it back to in
+*
+* Every element is moved twice and compared O(log n) times, in three rounds of
+* k independent tasks each, instead of the O(log^3 n) critical path of
+* cilksort's recursive merges. The number of buckets is n / cutoff 2, limited
+* to 256.
+*
+* Included by sort.cpp, after sort.h.
+*/
+
+#include <vector>
+#include <algorithm>
+
+// at most 256 buckets, so that the bucket of an element fits into a byte
+static const long MAX_TASKS = 256;
+
+// runs f(0) .. f(tasks - 1) as independent tasks and waits for all of them
+template<typename F>
+void parallel_tasks(const std::launch l, long tasks, F f) {
+	std::vector<inncabs::future<void>> futures;
+	futures.reserve(tasks);
+	for(long t = 0; t < tasks; ++t) futures.push_back(inncabs::async(l, f, t));
+	for(auto& future : futures) future.wait();
+}
+
+// number of tasks each round of the alternative algorithms is split into
+inline long task_count(long size) {
+	return std::max(1l, std::min(MAX_TASKS, size / std::max(1l, arg_cutoff_2)));
+}
+
+template<typename T, typename Compare>
+void samplesort_par(const std::launch l, T *low, T *tmp, long size) {
+	const long k = task_count(size);
+	if(k == 1) {
+		sort_leaf<T, Compare>(low, tmp, size);
+		return;
+	}
+	const long chunk = (size + k - 1) / k;
+
+	/* 8 samples per bucket, at a fixed stride so that runs are reproducible */
+	const long oversampling = 8;
+	std::vector<T> sample;
+	const long stride = std::max(1l, size / (k * oversampling));
+	for(long i = stride / 2; i < size && static_cast<long>(sample.size()) < k * oversampling; i += stride) sample.push_back(low[i]);
+	std::sort(sample.begin(), sample.end(), Compare());
+	std::vector<T> splitters;
+	for(long b = 1; b < k; ++b) splitters.push_back(sample[b * sample.size() / k]);
+
+	auto bucket = [&splitters](const T& e) {
+		return static_cast<long>(std::upper_bound(splitters.begin(), splitters.end(), e, Compare()) - splitters.begin());
+	};
+
+	/* counts[c * k + b] is the number of elements of chunk c in bucket b, the bucket of every element is kept for the scatter */
+	std::vector<long> counts(k * k, 0);
+	std::vector<unsigned char> buckets(size);
+	parallel_tasks(l, k, [&](long c) {
+		std::vector<long> local(k, 0);
+		const long end = std::min(size, (c + 1) * chunk);
+		for(long i = c * chunk; i < end; ++i) {
+			buckets[i] = static_cast<unsigned char>(bucket(low[i]));
+			++local[buckets[i]];
+		}
+		std::copy(local.begin(), local.end(), counts.begin() + c * k);
+	});
+
+	/* offsets of chunk c in bucket b, and the start of every bucket */
+	std::vector<long> offsets(k * k);
+	std::vector<long> starts(k + 1);
+	long sum = 0;
+	for(long b = 0; b < k; ++b) {
+		starts[b] = sum;
+		for(long c = 0; c < k; ++c) {
+			offsets[c * k + b] = sum;
+			sum += counts[c * k + b];
+		}
+	}
+	starts[k] = size;
+
+	parallel_tasks(l, k, [&](long c) {
+		long *offset = &offsets[c * k];
+		const long end = std::min(size, (c + 1) * chunk);
+		for(long i = c * chunk; i < end; ++i) tmp[offset[buckets[i]]++] = low[i];
+	});
+
+	parallel_tasks(l, k, [&](long b) {
+		const long begin = starts[b], n = starts[b + 1] - starts[b];
+		sort_leaf<T, Compare>(tmp + begin, low + begin, n);
+		memcpy(low + begin, tmp + begin, sizeof(T) * n);
+	});
+}
@@ -10,29 +10,69 @@
  */
 
 #include "sort.h"
+#include "samplesort.h"
+#include "radixsort.h"
 
-int main(int argc, char** argv) {
-	arg_size = 10000;
-	if(argc > 1) arg_size = atoi(argv[1]);
-	arg_cutoff_1 = 512;
-	if(argc > 2) arg_cutoff_1 = atoi(argv[2]);
-	arg_cutoff_2 = 512;
-	if(argc > 3) arg_cutoff_2 = atoi(argv[3]);
-	arg_cutoff_3 = 128;
-	if(argc > 4) arg_cutoff_3 = atoi(argv[4]);
+// runs the benchmark for elements of type T, ordered by Compare
+template<typename T, typename Compare>
+void run_sort(const std::string& type, const std::string& algorithm) {
+	// only cilksort has a dataflow variant
+	const bool dataflow = algorithm == "cilksort" && inncabs::dataflow::requested();
 
 	std::stringstream ss;
 	ss << "Sort with N = " << arg_size << ", cutoffs = " << arg_cutoff_1 << " / " << arg_cutoff_2 << " / " << arg_cutoff_3;
-	
+	if(type != "long") ss << ", " << type << " elements";
+	if(arg_kernel != sort_kernel::libc) ss << ", " << kernel_name(arg_kernel) << " kernel";
+	if(algorithm != "cilksort") ss << ", " << algorithm;
+	if(dataflow) ss << " (dataflow)";
+
+	inncabs::declare_work("element", static_cast<double>(arg_size), static_cast<double>(arg_size) * sizeof(T));
 	inncabs::run_all(
 		[&](const std::launch l) {
-			sort_par(l);
+			if(dataflow) sort_dataflow<T, Compare>(l);
+			else if(algorithm == "samplesort") samplesort_par<T, Compare>(l, sort_buffers<T>::array, sort_buffers<T>::tmp, arg_size);
+			else if(algorithm == "radix") radixsort_par<T>(l, sort_buffers<T>::array, sort_buffers<T>::tmp, arg_size);
+			else sort_par<T, Compare>(l);
 			return 1;
 		},
 		[&](int result) {
-			return sort_verify(); 
+			return sort_verify<T>(); 
 		},
 		ss.str(),
-		[&] { sort_init(); }
+		[&] { sort_init<T>(); }
 		);
 }
+
+INNCABS_MAIN(sort) {
+	arg_size = 10000;
+	if(argc > 1) arg_size = atol(argv[1]);
+	arg_cutoff_1 = 512;
+	if(argc > 2) arg_cutoff_1 = atol(argv[2]);
+	arg_cutoff_2 = 512;
+	if(argc > 3) arg_cutoff_2 = atol(argv[3]);
+	arg_cutoff_3 = 128;
+	if(argc > 4) arg_cutoff_3 = atol(argv[4]);
+	std::string type = "long";
+	if(argc > 5) type = argv[5];
+	std::string kernel = "qsort";
+	if(argc > 6) kernel = argv[6];
+	if(kernel == "network") arg_kernel = best_kernel();
+	else if(kernel == "qsort") arg_kernel = sort_kernel::libc;
+	else if(kernel == "scalar") arg_kernel = sort_kernel::scalar;
+	else if(kernel == "sse") arg_kernel = sort_kernel::sse;
+	else if(kernel == "avx2") arg_kernel = sort_kernel::avx2;
+	else inncabs::error("Error: unknown kernel " + kernel + ", expected qsort, network, scalar, sse or avx2\n");
+	std::string algorithm = "cilksort";
+	if(argc > 7) algorithm = argv[7];
+	if(algorithm != "cilksort" && algorithm != "samplesort" && algorithm != "radix") {
+		inncabs::error("Error: unknown algorithm " + algorithm + ", expected cilksort, samplesort or radix\n");
+	}
+	if(!kernel_supported(arg_kernel)) inncabs::error("Error: the " + kernel + " kernel is not supported on this machine\n");
+	sort_check_arguments();
+
+	if(type == "long") run_sort<ELM, std::less<ELM>>(type, algorithm);
+	else if(type == "int32") run_sort<std::int32_t, std::less<std::int32_t>>(type, algorithm);
+	else if(type == "double") run_sort<double, std::less<double>>(type, algorithm);
+	else if(type == "record") run_sort<record, record_less>(type, algorithm);
+	else inncabs::error("Error: unknown element type " + type + ", expected long, int32, double or record\n");
+}
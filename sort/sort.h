@@ -39,28 +39,58 @@
 #include "../include/inncabs.h"
 
 #include <cstring>
+#include <cstdint>
+#include <functional>
+
+#include "kernels.h"
 
 typedef long ELM;
 
-void seqquick(ELM *low, ELM *high); 
-void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest);
-ELM *binsplit(ELM val, ELM *low, ELM *high); 
-void cilkmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest);
-void cilkmerge_par(const std::launch l, ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest);
-void cilksort(ELM *low, ELM *tmp, long size);
-void cilksort_par(const std::launch l, ELM *low, ELM *tmp, long size);
-void scramble_array(ELM *array); 
-void fill_array(ELM *array); 
-void sort(); 
-
-void sort_par(const std::launch l);
-void sort_init();
-bool sort_verify();
-
-ELM *array, *tmp;
-ELM arg_size, arg_cutoff_1, arg_cutoff_2, arg_cutoff_3;
-
-void print(ELM* arr, int n) {
+// key with a payload, sorted by key
+struct record {
+	std::uint64_t key;
+	std::uint64_t payload;
+};
+
+struct record_less {
+	bool operator()(const record& a, const record& b) const { return a.key < b.key; }
+};
+
+static long arg_size, arg_cutoff_1, arg_cutoff_2, arg_cutoff_3;
+static sort_kernel arg_kernel = sort_kernel::libc;
+
+/*
+* The input is a scrambled permutation of the elements for the keys 0..size-1,
+* element<T> creates the element for a key and checks a sorted one.
+*/
+template<typename T>
+struct element {
+	static T make(long i) { return static_cast<T>(i); }
+	static bool matches(const T& e, long i) { return e == make(i); }
+};
+
+template<>
+struct element<record> {
+	static record make(long i) {
+		record r = { static_cast<std::uint64_t>(i), static_cast<std::uint64_t>(i) * 2654435761u };
+		return r;
+	}
+	static bool matches(const record& e, long i) { return e.key == make(i).key && e.payload == make(i).payload; }
+};
+
+// the arrays sorted by the current run, one pair per element type
+template<typename T>
+struct sort_buffers {
+	static T *array, *tmp;
+};
+
+template<typename T>
+T* sort_buffers<T>::array = nullptr;
+template<typename T>
+T* sort_buffers<T>::tmp = nullptr;
+
+template<typename T>
+void print(T* arr, int n) {
 	for(int i=0; i<n; ++i) {
 		std::cout << arr[i] << ",";
 	}
@@ -78,13 +108,18 @@ static inline void my_srand(unsigned long seed) {
 	rand_nxt = seed;
 }
 
+template<typename T, typename Compare>
 int cmpfunc(const void* a, const void* b) {
-	return *(ELM*)a - *(ELM*)b;
+	const Compare comp;
+	if(comp(*(const T*)a, *(const T*)b)) return -1;
+	if(comp(*(const T*)b, *(const T*)a)) return 1;
+	return 0;
 }
 
-void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
-	ELM a1, a2;
-
+template<typename T, typename Compare>
+void seqmerge(T *low1, T *high1, T *low2, T *high2, T *lowdest) {
+	const Compare comp;
+	T a1, a2;
 	/*
 	* The following 'if' statement is not necessary
 	* for the correctness of the algorithm, and is
@@ -92,7 +127,7 @@ void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
 	* However, it is a few percent faster.  Here is why.
 	*
 	* The merging loop below has something like
-	*   if (a1 < a2) {
+	*   if (comp(a1, a2)) {
 	*        *dest++ = a1;
 	*        ++low1;
 	*        if (end of array) break;
@@ -115,7 +150,7 @@ void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
 		a1 = *low1;
 		a2 = *low2;
 		while(1) {
-			if(a1 < a2) {
+			if(comp(a1, a2)) {
 				*lowdest++ = a1;
 				a1 = *++low1;
 				if (low1 >= high1)
@@ -132,7 +167,7 @@ void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
 		a1 = *low1;
 		a2 = *low2;
 		while(1) {
-			if (a1 < a2) {
+			if (comp(a1, a2)) {
 				*lowdest++ = a1;
 				++low1;
 				if(low1 > high1)
@@ -148,48 +183,57 @@ void seqmerge(ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
 		}
 	}
 	if(low1 > high1) {
-		memcpy(lowdest, low2, sizeof(ELM) * (high2 - low2 + 1));
+		memcpy(lowdest, low2, sizeof(T) * (high2 - low2 + 1));
 	} else {
-		memcpy(lowdest, low1, sizeof(ELM) * (high1 - low1 + 1));
+		memcpy(lowdest, low1, sizeof(T) * (high1 - low1 + 1));
 	}
 }
 
-#define swap_indices(a, b) \
-{ \
-	ELM *tmp;\
-	tmp = a;\
-	a = b;\
-	b = tmp;\
+/* sorts a leaf below cutoff 2 with the selected kernel */
+template<typename T, typename Compare>
+void sort_leaf(T *low, T *tmp, long size) {
+	if(arg_kernel == sort_kernel::libc) qsort(low, size, sizeof(T), &cmpfunc<T, Compare>);
+	else network_sort<T, Compare>(arg_kernel, low, tmp, size);
+}
+
+/* merges two ranges below cutoff 1 with the selected kernel */
+template<typename T, typename Compare>
+void merge_leaf(T *low1, T *high1, T *low2, T *high2, T *lowdest) {
+	if(arg_kernel == sort_kernel::libc) seqmerge<T, Compare>(low1, high1, low2, high2, lowdest);
+	else branchless_merge<T, Compare>(low1, high1 + 1, low2, high2 + 1, lowdest);
 }
 
-ELM *binsplit(ELM val, ELM *low, ELM *high) {
+template<typename T, typename Compare>
+T *binsplit(const T& val, T *low, T *high) {
 	/*
 	* returns index which contains greatest element <= val.  If val is
 	* less than all elements, returns low-1
 	*/
-	ELM *mid;
+	const Compare comp;
+	T *mid;
 
 	while(low != high) {
 		mid = low + ((high - low + 1) >> 1);
-		if (val <= *mid)
+		if (!comp(*mid, val))
 			high = mid - 1;
 		else
 			low = mid;
 	}
 
-	if(*low > val)
+	if(comp(val, *low))
 		return low - 1;
 	else
 		return low;
 }
 
-void cilkmerge_par(const std::launch l, ELM *low1, ELM *high1, ELM *low2, ELM *high2, ELM *lowdest) {
+template<typename T, typename Compare>
+void cilkmerge_par(const std::launch l, T *low1, T *high1, T *low2, T *high2, T *lowdest) {
 	/*
 	* Cilkmerge: Merges range [low1, high1] with range [low2, high2] 
 	* into the range [lowdest, ...]  
 	*/
 
-	ELM *split1, *split2;	/*
+	T *split1, *split2;	/*
 							* where each of the ranges are broken for 
 							* recursive merge 
 							*/
@@ -206,16 +250,16 @@ void cilkmerge_par(const std::launch l, ELM *low1, ELM *high1, ELM *low2, ELM *h
 	*/
 
 	if(high2 - low2 > high1 - low1) {
-		swap_indices(low1, low2);
-		swap_indices(high1, high2);
+		std::swap(low1, low2);
+		std::swap(high1, high2);
 	}
 	if(high2 < low2) {
 		/* smaller range is empty */
-		memcpy(lowdest, low1, sizeof(ELM) * (high1 - low1));
+		memcpy(lowdest, low1, sizeof(T) * (high1 - low1 + 1));
 		return;
 	}
 	if(high2 - low2 < arg_cutoff_1 ) {
-		seqmerge(low1, high1, low2, high2, lowdest);
+		merge_leaf<T, Compare>(low1, high1, low2, high2, lowdest);
 		return;
 	}
 	/*
@@ -226,7 +270,7 @@ void cilkmerge_par(const std::launch l, ELM *low1, ELM *high1, ELM *low2, ELM *h
 	*/
 
 	split1 = ((high1 - low1 + 1) / 2) + low1;
-	split2 = binsplit(*split1, low2, high2);
+	split2 = binsplit<T, Compare>(*split1, low2, high2);
 	lowsize = split1 - low1 + split2 - low2;
 
 	/* 
@@ -234,14 +278,15 @@ void cilkmerge_par(const std::launch l, ELM *low1, ELM *high1, ELM *low2, ELM *h
 	* the appropriate location
 	*/
 	*(lowdest + lowsize + 1) = *split1;
-	std::future<void> f1 = std::async(l, cilkmerge_par, l, low1, split1 - 1, low2, split2, lowdest);
-	std::future<void> f2 = std::async(l, cilkmerge_par, l, split1 + 1, high1, split2 + 1, high2, lowdest + lowsize + 2);
+	inncabs::future<void> f1 = inncabs::async(l, cilkmerge_par<T, Compare>, l, low1, split1 - 1, low2, split2, lowdest);
+	inncabs::future<void> f2 = inncabs::async(l, cilkmerge_par<T, Compare>, l, split1 + 1, high1, split2 + 1, high2, lowdest + lowsize + 2);
 	f1.wait();
 	f2.wait();
 	return;
 }
 
-void cilksort_par(const std::launch l, ELM *low, ELM *tmp, long size) {
+template<typename T, typename Compare>
+void cilksort_par(const std::launch l, T *low, T *tmp, long size) {
 	/*
 	* divide the input in four parts of the same size (A, B, C, D)
 	* Then:
@@ -250,11 +295,11 @@ void cilksort_par(const std::launch l, ELM *low, ELM *tmp, long size) {
 	*   3) merge tmp1 and tmp2 into the original array
 	*/
 	long quarter = size / 4;
-	ELM *A, *B, *C, *D, *tmpA, *tmpB, *tmpC, *tmpD;
+	T *A, *B, *C, *D, *tmpA, *tmpB, *tmpC, *tmpD;
 
 	if(size < arg_cutoff_2) {
-		/* quicksort when less than cutoff elements */
-		qsort(low, size, sizeof(ELM), &cmpfunc);
+		/* sequential sort when less than cutoff elements */
+		sort_leaf<T, Compare>(low, tmp, size);
 		return;
 	}
 	A = low;
@@ -266,42 +311,109 @@ void cilksort_par(const std::launch l, ELM *low, ELM *tmp, long size) {
 	D = C + quarter;
 	tmpD = tmpC + quarter;
 
-	std::future<void> f1 = std::async(l, cilksort_par, l, A, tmpA, quarter);
-	std::future<void> f2 = std::async(l, cilksort_par, l, B, tmpB, quarter);
-	std::future<void> f3 = std::async(l, cilksort_par, l, C, tmpC, quarter);
-	std::future<void> f4 = std::async(l, cilksort_par, l, D, tmpD, size - 3 * quarter);
+	inncabs::future<void> f1 = inncabs::async(l, cilksort_par<T, Compare>, l, A, tmpA, quarter);
+	inncabs::future<void> f2 = inncabs::async(l, cilksort_par<T, Compare>, l, B, tmpB, quarter);
+	inncabs::future<void> f3 = inncabs::async(l, cilksort_par<T, Compare>, l, C, tmpC, quarter);
+	inncabs::future<void> f4 = inncabs::async(l, cilksort_par<T, Compare>, l, D, tmpD, size - 3 * quarter);
 	f1.wait();
 	f2.wait();
 	f3.wait();
 	f4.wait();
 
-	std::future<void> f5 = std::async(l, cilkmerge_par, l, A, A + quarter - 1, B, B + quarter - 1, tmpA);
-	std::future<void> f6 = std::async(l, cilkmerge_par, l, C, C + quarter - 1, D, low + size - 1, tmpC);
+	inncabs::future<void> f5 = inncabs::async(l, cilkmerge_par<T, Compare>, l, A, A + quarter - 1, B, B + quarter - 1, tmpA);
+	inncabs::future<void> f6 = inncabs::async(l, cilkmerge_par<T, Compare>, l, C, C + quarter - 1, D, low + size - 1, tmpC);
 	f5.wait();
 	f6.wait();
 
-	cilkmerge_par(l, tmpA, tmpC - 1, tmpC, tmpA + size - 1, A);
+	cilkmerge_par<T, Compare>(l, tmpA, tmpC - 1, tmpC, tmpA + size - 1, A);
 }
 
-void scramble_array(ELM *array) {
+/*
+* Continuation-style variants of cilkmerge_par and cilksort_par: instead of
+* waiting for its children, a task returns a future which is ready once they
+* are, and the merge steps are attached to the sorts they depend on.
+*/
+template<typename T, typename Compare>
+inncabs::dataflow::future<void> cilkmerge_dataflow(const std::launch l, T *low1, T *high1, T *low2, T *high2, T *lowdest) {
+	T *split1, *split2;
+	long int lowsize;
+
+	if(high2 - low2 > high1 - low1) {
+		std::swap(low1, low2);
+		std::swap(high1, high2);
+	}
+	if(high2 < low2) {
+		memcpy(lowdest, low1, sizeof(T) * (high1 - low1 + 1));
+		return inncabs::dataflow::make_ready_future();
+	}
+	if(high2 - low2 < arg_cutoff_1 ) {
+		merge_leaf<T, Compare>(low1, high1, low2, high2, lowdest);
+		return inncabs::dataflow::make_ready_future();
+	}
+
+	split1 = ((high1 - low1 + 1) / 2) + low1;
+	split2 = binsplit<T, Compare>(*split1, low2, high2);
+	lowsize = split1 - low1 + split2 - low2;
+
+	*(lowdest + lowsize + 1) = *split1;
+	auto f1 = inncabs::dataflow::async(l, cilkmerge_dataflow<T, Compare>, l, low1, split1 - 1, low2, split2, lowdest);
+	auto f2 = inncabs::dataflow::async(l, cilkmerge_dataflow<T, Compare>, l, split1 + 1, high1, split2 + 1, high2, lowdest + lowsize + 2);
+	return inncabs::dataflow::when_all(f1, f2);
+}
+
+template<typename T, typename Compare>
+inncabs::dataflow::future<void> cilksort_dataflow(const std::launch l, T *low, T *tmp, long size) {
+	long quarter = size / 4;
+	T *A, *B, *C, *D, *tmpA, *tmpB, *tmpC, *tmpD;
+
+	if(size < arg_cutoff_2) {
+		sort_leaf<T, Compare>(low, tmp, size);
+		return inncabs::dataflow::make_ready_future();
+	}
+	A = low;
+	tmpA = tmp;
+	B = A + quarter;
+	tmpB = tmpA + quarter;
+	C = B + quarter;
+	tmpC = tmpB + quarter;
+	D = C + quarter;
+	tmpD = tmpC + quarter;
+
+	auto f1 = inncabs::dataflow::async(l, cilksort_dataflow<T, Compare>, l, A, tmpA, quarter);
+	auto f2 = inncabs::dataflow::async(l, cilksort_dataflow<T, Compare>, l, B, tmpB, quarter);
+	auto f3 = inncabs::dataflow::async(l, cilksort_dataflow<T, Compare>, l, C, tmpC, quarter);
+	auto f4 = inncabs::dataflow::async(l, cilksort_dataflow<T, Compare>, l, D, tmpD, size - 3 * quarter);
+
+	return inncabs::dataflow::when_all(f1, f2, f3, f4).then([=](inncabs::dataflow::future<void>) {
+		auto f5 = inncabs::dataflow::async(l, cilkmerge_dataflow<T, Compare>, l, A, A + quarter - 1, B, B + quarter - 1, tmpA);
+		auto f6 = inncabs::dataflow::async(l, cilkmerge_dataflow<T, Compare>, l, C, C + quarter - 1, D, low + size - 1, tmpC);
+		return inncabs::dataflow::when_all(f5, f6).then([=](inncabs::dataflow::future<void>) {
+			return cilkmerge_dataflow<T, Compare>(l, tmpA, tmpC - 1, tmpC, tmpA + size - 1, A);
+		});
+	});
+}
+
+template<typename T>
+void scramble_array(T *array) {
 	unsigned long j;
 
-	for (ELM i = 0; i < arg_size; ++i) {
+	for (long i = 0; i < arg_size; ++i) {
 		j = my_rand();
 		j = j % arg_size;
 		std::swap(array[i], array[j]);
 	}
 }
 
-void fill_array(ELM *array) {
+template<typename T>
+void fill_array(T *array) {
 	my_srand(1);
 	/* first, fill with integers 1..size */
-	for (ELM i = 0; i < arg_size; ++i) {
-		array[i] = i;
+	for (long i = 0; i < arg_size; ++i) {
+		array[i] = element<T>::make(i);
 	}
 }
 
-void sort_init() {
+void sort_check_arguments() {
 	/* Checking arguments */
 	if(arg_size < 4) {
 		inncabs::message("N can not be less than 4, using 4 as a parameter.");
@@ -338,26 +450,41 @@ void sort_init() {
 		inncabs::message(ss.str());
 		arg_cutoff_3 = arg_cutoff_2;
 	}
+}
 
-	array = (ELM *) malloc(arg_size * sizeof(ELM));
-	tmp = (ELM *) malloc(arg_size * sizeof(ELM));
+template<typename T>
+void sort_init() {
+	T*& array = sort_buffers<T>::array;
+	T*& tmp = sort_buffers<T>::tmp;
+	array = (T *) malloc(arg_size * sizeof(T));
+	tmp = (T *) malloc(arg_size * sizeof(T));
 	fill_array(array);
 	scramble_array(array);
 }
 
+template<typename T, typename Compare>
 void sort_par(const std::launch l) {
 	inncabs::message("Computing multisort algorithm");
-	cilksort_par(l, array, tmp, arg_size);
+	cilksort_par<T, Compare>(l, sort_buffers<T>::array, sort_buffers<T>::tmp, arg_size);
+	inncabs::message(" completed!\n");
+}
+
+template<typename T, typename Compare>
+void sort_dataflow(const std::launch l) {
+	inncabs::message("Computing multisort algorithm (dataflow)");
+	cilksort_dataflow<T, Compare>(l, sort_buffers<T>::array, sort_buffers<T>::tmp, arg_size).get();
 	inncabs::message(" completed!\n");
 }
 
+template<typename T>
 bool sort_verify() {
-	for(int i = 0; i < arg_size; ++i) {
-		if(array[i] != i) {
+	T* array = sort_buffers<T>::array;
+	for(long i = 0; i < arg_size; ++i) {
+		if(!element<T>::matches(array[i], i)) {
 			return false;
 		}
 	}
 	free(array);
-	free(tmp);
+	free(sort_buffers<T>::tmp);
 	return true;
 }
@@ -8,7 +8,7 @@
 
 #include "sparselu.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(sparselu) {
 	arg_size_1 = 50;
 	if(argc > 1) arg_size_1 = atoi(argv[1]);
 	arg_size_2 = 100;
@@ -30,6 +30,14 @@ int main(int argc, char** argv) {
 			return sparselu_check(SEQ, BENCH);
 		},
 		ss.str(),
-		[&] { sparselu_init(&BENCH, "benchmark"); }
+		[&] {
+			// the matrix of the previous repetition is factorized already
+			if(BENCH) sparselu_free(BENCH);
+			sparselu_init(&BENCH, "benchmark");
+		}
 		);
+
+	if(BENCH) sparselu_free(BENCH);
+	BENCH = NULL;
+	sparselu_free(SEQ);
 }
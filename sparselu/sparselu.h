@@ -6,7 +6,12 @@ int arg_size_1, arg_size_2;
 float **SEQ,**BENCH;
 
 bool checkmat(float *M, float *N);
+bool null_block(int ii, int jj);
+bool placed_blocks();
+size_t num_blocks();
+size_t num_fill_blocks();
 void genmat(float *M[]);
+void freemat(float *M[]);
 void print_structure(const char *name, float *M[]);
 float* allocate_clean_block();
 void lu0(float *diag);
@@ -15,6 +20,7 @@ void bmod(float *row, float *col, float *inner);
 void fwd(float *diag, float *col);
 
 void sparselu_init(float ***pBENCH, const char *pass); 
+void sparselu_free(float **BENCH);
 void sparselu(float **BENCH);
 void sparselu_fini(float **BENCH, const char *pass); 
 
@@ -26,6 +32,7 @@ bool sparselu_check(float **SEQ, float **BENCH);
 ///////////////////////////////////////////////// IMPLEMENTATION
 
 #include <vector>
+#include <atomic>
 
 #define TRUE  1
 #define FALSE 0
@@ -61,29 +68,90 @@ bool checkmat(float *M, float *N) {
 	return true;
 }
 
+bool null_block(int ii, int jj) {
+	int null_entry = FALSE;
+	if((ii<jj) && (ii%3 !=0)) null_entry = TRUE;
+	if((ii>jj) && (jj%3 !=0)) null_entry = TRUE;
+	if(ii%2==1) null_entry = TRUE;
+	if(jj%2==1) null_entry = TRUE;
+	if(ii==jj) null_entry = FALSE;
+	if(ii==jj-1) null_entry = FALSE;
+	if(ii-1 == jj) null_entry = FALSE; 
+	return null_entry == TRUE;
+}
+
+/* with a placement policy, all blocks of a matrix, including those filled in by the factorization,
+   are carved from one buffer placed according to INNCABS_NUMA, otherwise every block is allocated on its own */
+bool placed_blocks() {
+	return inncabs::numa::current_policy() != inncabs::numa::DEFAULT;
+}
+
+/* fill-in blocks of the placed buffer of the most recently generated matrix, handed out by allocate_clean_block */
+float *fill_blocks;
+std::atomic<size_t> next_fill_block;
+
+/* number of blocks which are not null initially */
+size_t num_blocks() {
+	size_t blocks = 0;
+	for(int ii=0; ii < arg_size_1; ii++) {
+		for(int jj=0; jj < arg_size_1; jj++) {
+			if(!null_block(ii, jj)) blocks++;
+		}
+	}
+	return blocks;
+}
+
+/* number of blocks the factorization fills in, from the structure of the matrix alone */
+size_t num_fill_blocks() {
+	std::vector<bool> present(arg_size_1*arg_size_1);
+	for(int ii=0; ii < arg_size_1; ii++) {
+		for(int jj=0; jj < arg_size_1; jj++) present[ii*arg_size_1+jj] = !null_block(ii, jj);
+	}
+	size_t blocks = 0;
+	for(int kk=0; kk < arg_size_1; kk++) {
+		for(int ii=kk+1; ii < arg_size_1; ii++) {
+			if(!present[ii*arg_size_1+kk]) continue;
+			for(int jj=kk+1; jj < arg_size_1; jj++) {
+				if(present[kk*arg_size_1+jj] && !present[ii*arg_size_1+jj]) {
+					present[ii*arg_size_1+jj] = true;
+					blocks++;
+				}
+			}
+		}
+	}
+	return blocks;
+}
+
 void genmat(float *M[]) {
-	int null_entry, init_val, i, j, ii, jj;
+	int init_val, i, j, ii, jj;
 	float *p;
 
 	init_val = 1325;
 
+	float *blocks = NULL;
+	if(placed_blocks()) {
+		blocks = inncabs::numa::alloc_array<float>((num_blocks()+num_fill_blocks())*arg_size_2*arg_size_2);
+		if(blocks == NULL) {
+			inncabs::error("Error: Out of memory\n");
+		}
+		fill_blocks = blocks + num_blocks()*arg_size_2*arg_size_2;
+		next_fill_block.store(0);
+	}
+
 	/* generating the structure */
 	for(ii=0; ii < arg_size_1; ii++) {
 		for(jj=0; jj < arg_size_1; jj++) {
-			/* computing null entries */
-			null_entry = FALSE;
-			if((ii<jj) && (ii%3 !=0)) null_entry = TRUE;
-			if((ii>jj) && (jj%3 !=0)) null_entry = TRUE;
-			if(ii%2==1) null_entry = TRUE;
-			if(jj%2==1) null_entry = TRUE;
-			if(ii==jj) null_entry = FALSE;
-			if(ii==jj-1) null_entry = FALSE;
-			if(ii-1 == jj) null_entry = FALSE; 
-			/* allocating matrix */
-			if(null_entry == FALSE){
-				M[ii*arg_size_1+jj] = (float *) malloc(arg_size_2*arg_size_2*sizeof(float));
-				if(M[ii*arg_size_1+jj] == NULL) {
-					inncabs::error("Error: Out of memory\n");
+			if(!null_block(ii, jj)) {
+				/* allocating matrix */
+				if(blocks) {
+					M[ii*arg_size_1+jj] = blocks;
+					blocks += arg_size_2*arg_size_2;
+				}
+				else {
+					M[ii*arg_size_1+jj] = (float *) malloc(arg_size_2*arg_size_2*sizeof(float));
+					if(M[ii*arg_size_1+jj] == NULL) {
+						inncabs::error("Error: Out of memory\n");
+					}
 				}
 				/* initializing matrix */
 				p = M[ii*arg_size_1+jj];
@@ -102,6 +170,18 @@ void genmat(float *M[]) {
 	}
 }
 
+/* releases the blocks of a matrix, the placed buffer starts with the diagonal block (0,0) */
+void freemat(float *M[]) {
+	if(arg_size_1 < 1) return;
+	if(placed_blocks()) {
+		inncabs::numa::free(M[0], (num_blocks()+num_fill_blocks())*arg_size_2*arg_size_2*sizeof(float));
+		return;
+	}
+	for(int ii=0; ii < arg_size_1; ii++) {
+		for(int jj=0; jj < arg_size_1; jj++) free(M[ii*arg_size_1+jj]);
+	}
+}
+
 void print_structure(const char *name, float *M[]) {
 	std::stringstream ss;
 	ss << "Structure for matrix " << name << " @ 0x" << M << "\n";
@@ -120,7 +200,8 @@ float* allocate_clean_block() {
 	int i,j;
 	float *p, *q;
 
-	p = (float *) malloc(arg_size_2*arg_size_2*sizeof(float));
+	if(placed_blocks()) p = fill_blocks + next_fill_block.fetch_add(1)*arg_size_2*arg_size_2;
+	else p = (float *) malloc(arg_size_2*arg_size_2*sizeof(float));
 	q = p;
 	if(p!=NULL) {
 		for(i = 0; i < arg_size_2; i++) {
@@ -177,17 +258,22 @@ void sparselu_init(float ***pBENCH, const char *pass) {
 	print_structure(pass, *pBENCH);
 }
 
+void sparselu_free(float **BENCH) {
+	freemat(BENCH);
+	free(BENCH);
+}
+
 void sparselu_par_call(const std::launch l, float **BENCH) {
 	for(int kk=0; kk<arg_size_1; kk++) {
 		lu0(BENCH[kk*arg_size_1+kk]);
 		for(int jj=kk+1; jj<arg_size_1; jj++) {
-			std::vector<std::future<void>> futures;
+			std::vector<inncabs::future<void>> futures;
 			if(BENCH[kk*arg_size_1+jj] != NULL) {
-				futures.push_back(std::async(l, fwd, BENCH[kk*arg_size_1+kk], BENCH[kk*arg_size_1+jj]));
+				futures.push_back(inncabs::async(l, fwd, BENCH[kk*arg_size_1+kk], BENCH[kk*arg_size_1+jj]));
 			}
 			for(int ii=kk+1; ii<arg_size_1; ii++) {
 				if(BENCH[ii*arg_size_1+kk] != NULL)	{
-					futures.push_back(std::async(l, bdiv, BENCH[kk*arg_size_1+kk], BENCH[ii*arg_size_1+kk]));
+					futures.push_back(inncabs::async(l, bdiv, BENCH[kk*arg_size_1+kk], BENCH[ii*arg_size_1+kk]));
 				}
 			}
 			for(auto& f : futures) {
@@ -199,7 +285,7 @@ void sparselu_par_call(const std::launch l, float **BENCH) {
 				if(BENCH[ii*arg_size_1+kk] != NULL) {
 					for(jj=kk+1; jj<arg_size_1; jj++) {
 						if(BENCH[kk*arg_size_1+jj] != NULL)	{
-							futures.push_back(std::async(l, [=]() {
+							futures.push_back(inncabs::async(l, [=]() {
 								if(BENCH[ii*arg_size_1+jj]==NULL) BENCH[ii*arg_size_1+jj] = allocate_clean_block();
 								bmod(BENCH[ii*arg_size_1+kk], BENCH[kk*arg_size_1+jj], BENCH[ii*arg_size_1+jj]);
 							} ) );
@@ -10,7 +10,7 @@
 
 #include "strassen.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(strassen) {
 	arg_size = 1024;
 	if(argc > 1) arg_size = atoi(argv[1]);
 	arg_cutoff_value = 64;
@@ -22,9 +22,12 @@ int main(int argc, char** argv) {
 	REAL *C = alloc_matrix(arg_size);
 	REAL *D = alloc_matrix(arg_size);
 
+	const bool dataflow = inncabs::dataflow::requested();
+
 	std::stringstream ss;
 	ss << "Strassen Algorithm (" << arg_size << " x " << arg_size 
 		<< " matrix with cutoff " << arg_cutoff_value << ") ";
+	if(dataflow) ss << "(dataflow) ";
 
 	init_matrix(arg_size, A, arg_size);
 	init_matrix(arg_size, B, arg_size);
@@ -32,7 +35,8 @@ int main(int argc, char** argv) {
 
 	inncabs::run_all(
 		[&](const std::launch l) {
-			OptimizedStrassenMultiply_par(l, C, A, B, arg_size, arg_size, arg_size, arg_size, 1);
+			if(dataflow) OptimizedStrassenMultiply_dataflow(l, C, A, B, arg_size, arg_size, arg_size, arg_size, 1).get();
+			else OptimizedStrassenMultiply_par(l, C, A, B, arg_size, arg_size, arg_size, arg_size, 1);
 			return 1;
 		},
 		[&](int result) {
@@ -40,4 +44,9 @@ int main(int argc, char** argv) {
 		},
 		ss.str()
 		);
+
+	free_matrix(arg_size, A);
+	free_matrix(arg_size, B);
+	free_matrix(arg_size, C);
+	free_matrix(arg_size, D);
 }
@@ -53,7 +53,7 @@ typedef double REAL;
 typedef unsigned long PTR;
 
 // parameters
-unsigned arg_cutoff_value, arg_size;
+static unsigned arg_cutoff_value, arg_size;
 
 /*FIXME: at the moment we use a constant value, change to parameter ???*/
 /* Below this cut off  strassen uses FastAdditiveNaiveMatrixMultiply algorithm */
@@ -87,7 +87,10 @@ void OptimizedStrassenMultiply_par(const std::launch l, REAL *C, REAL *A, REAL *
      unsigned RowWidthC, unsigned RowWidthA, unsigned RowWidthB, int Depth);
 void OptimizedStrassenMultiply_seq(REAL *C, REAL *A, REAL *B, unsigned MatrixSize,
      unsigned RowWidthC, unsigned RowWidthA, unsigned RowWidthB, int Depth);
+inncabs::dataflow::future<void> OptimizedStrassenMultiply_dataflow(const std::launch l, REAL *C, REAL *A, REAL *B, unsigned MatrixSize,
+     unsigned RowWidthC, unsigned RowWidthA, unsigned RowWidthB, int Depth);
 REAL *alloc_matrix(int n);
+void free_matrix(int n, REAL *A);
 void init_matrix(int n, REAL *A, int an);
 void strassen_main_par(REAL *A, REAL *B, REAL *C, int n);
 void strassen_main_seq(REAL *A, REAL *B, REAL *C, int n);
@@ -747,28 +750,28 @@ void OptimizedStrassenMultiply_par(const std::launch l, REAL *C, REAL *A, REAL *
 		MatrixOffsetB += RowIncrementB;
 	} /* end column loop */
 
-	std::vector<std::future<void>> futures;
+	std::vector<inncabs::future<void>> futures;
 
 	/* M2 = A11 x B11 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, M2, A11, B11, QuadrantSize, QuadrantSize, RowWidthA, RowWidthB, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, M2, A11, B11, QuadrantSize, QuadrantSize, RowWidthA, RowWidthB, Depth+1));
 
 	/* M5 = S1 * S5 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, M5, S1, S5, QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, M5, S1, S5, QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
 
 	/* Step 1 of T1 = S2 x S6 + M2 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, T1sMULT, S2, S6,  QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, T1sMULT, S2, S6,  QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
 
 	/* Step 1 of T2 = T1 + S3 x S7 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, C22, S3, S7, QuadrantSize, RowWidthC /*FIXME*/, QuadrantSize, QuadrantSize, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, C22, S3, S7, QuadrantSize, RowWidthC /*FIXME*/, QuadrantSize, QuadrantSize, Depth+1));
 
 	/* Step 1 of C11 = M2 + A12 * B21 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, C11, A12, B21, QuadrantSize, RowWidthC, RowWidthA, RowWidthB, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, C11, A12, B21, QuadrantSize, RowWidthC, RowWidthA, RowWidthB, Depth+1));
 
 	/* Step 1 of C12 = S4 x B22 + T1 + M5 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, C12, S4, B22, QuadrantSize, RowWidthC, QuadrantSize, RowWidthB, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, C12, S4, B22, QuadrantSize, RowWidthC, QuadrantSize, RowWidthB, Depth+1));
 
 	/* Step 1 of C21 = T2 - A22 * S8 */
-	futures.push_back(std::async(l, OptimizedStrassenMultiply_par, l, C21, A22, S8, QuadrantSize, RowWidthC, RowWidthA, QuadrantSize, Depth+1));
+	futures.push_back(inncabs::async(l, OptimizedStrassenMultiply_par, l, C21, A22, S8, QuadrantSize, RowWidthC, RowWidthA, QuadrantSize, Depth+1));
 
 	/**********************************************
 	** Synchronization Point
@@ -836,6 +839,217 @@ void OptimizedStrassenMultiply_par(const std::launch l, REAL *C, REAL *A, REAL *
 	free(StartHeap);
 }
 
+/*
+* Continuation-style variant of OptimizedStrassenMultiply_par: the seven
+* products are spawned with dataflow::async, and the step combining them
+* into C is attached to their completion instead of waiting for them.
+* Uses the quadrant and element macros defined above.
+*/
+inncabs::dataflow::future<void> OptimizedStrassenMultiply_dataflow(const std::launch l, REAL *C, REAL *A, REAL *B, unsigned MatrixSize, unsigned RowWidthC, unsigned RowWidthA, unsigned RowWidthB, int Depth) {
+	unsigned QuadrantSize = MatrixSize >> 1; /* MatixSize / 2 */
+	unsigned QuadrantSizeInBytes = sizeof(REAL) * QuadrantSize * QuadrantSize + 32;
+	unsigned Column, Row;
+
+	/************************************************************************
+	** For each matrix A, B, and C, we'll want pointers to each quandrant
+	** in the matrix. These quandrants will be addressed as follows:
+	**  --        --
+	**  | A11  A12 |
+	**  |          |
+	**  | A21  A22 |
+	**  --        --
+	************************************************************************/
+	REAL /* *A11, *B11, *C11, */ *A12, *B12, *C12,
+		*A21, *B21, *C21, *A22, *B22, *C22;
+
+	REAL *S1,*S2,*S3,*S4,*S5,*S6,*S7,*S8,*M2,*M5,*T1sMULT;
+
+	PTR TempMatrixOffset = 0;
+	PTR MatrixOffsetA = 0;
+	PTR MatrixOffsetB = 0;
+
+	char *Heap;
+	void *StartHeap;
+
+	/* Distance between the end of a matrix row and the start of the next row */
+	PTR RowIncrementA = ( RowWidthA - QuadrantSize ) << 3;
+	PTR RowIncrementB = ( RowWidthB - QuadrantSize ) << 3;
+	PTR RowIncrementC = ( RowWidthC - QuadrantSize ) << 3;
+
+	if(MatrixSize <= arg_cutoff_value) {
+		MultiplyByDivideAndConquer(C, A, B, MatrixSize, RowWidthC, RowWidthA, RowWidthB, 0);
+		return inncabs::dataflow::make_ready_future();
+	}
+
+	/* Initialize quandrant matrices */
+	A12 = A11 + QuadrantSize;
+	B12 = B11 + QuadrantSize;
+	C12 = C11 + QuadrantSize;
+	A21 = A + (RowWidthA * QuadrantSize);
+	B21 = B + (RowWidthB * QuadrantSize);
+	C21 = C + (RowWidthC * QuadrantSize);
+	A22 = A21 + QuadrantSize;
+	B22 = B21 + QuadrantSize;
+	C22 = C21 + QuadrantSize;
+
+	/* Allocate Heap Space Here */
+	StartHeap = Heap = (char*)malloc(QuadrantSizeInBytes * NumberOfVariables);
+	/* ensure that heap is on cache boundary */
+	if(((PTR)Heap) & 31)
+		Heap = (char*)(((PTR)Heap) + 32 - (((PTR)Heap) & 31));
+
+	/* Distribute the heap space over the variables */
+	S1 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S2 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S3 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S4 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S5 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S6 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S7 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	S8 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	M2 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	M5 = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+	T1sMULT = (REAL*) Heap; Heap += QuadrantSizeInBytes;
+
+	/***************************************************************************
+	** Step through all columns row by row (vertically)
+	** (jumps in memory by RowWidth => bad locality)
+	** (but we want the best locality on the innermost loop)
+	***************************************************************************/
+	for(Row = 0; Row < QuadrantSize; Row++) {
+
+		/*************************************************************************
+		** Step through each row horizontally (addressing elements in each column)
+		** (jumps linearly througn memory => good locality)
+		*************************************************************************/
+		for(Column = 0; Column < QuadrantSize; Column++) {
+
+			/***********************************************************
+			** Within this loop, the following holds for MatrixOffset:
+			** MatrixOffset = (Row * RowWidth) + Column
+			** (note: that the unit of the offset is number of reals)
+			***********************************************************/
+			/* Element of Global Matrix, such as A, B, C */
+
+			//~ /* FIXME - may pay to expand these out - got higher speed-ups below */
+			//~ /* S4 = A12 - ( S2 = ( S1 = A21 + A22 ) - A11 ) */
+			//~ E(S4) = EA(A12) - ( E(S2) = ( E(S1) = EA(A21) + EA(A22) ) - EA(A11) );
+
+			//~ /* S8 = (S6 = B22 - ( S5 = B12 - B11 ) ) - B21 */
+			//~ E(S8) = ( E(S6) = EB(B22) - ( E(S5) = EB(B12) - EB(B11) ) ) - EB(B21);
+
+			// INSIEME fix
+			E(S1) = EA(A21) + EA(A22);
+			E(S2) = E(S1)- EA(A11);
+			E(S4) = EA(A12) - E(S2);
+
+			E(S5) = EB(B12) - EB(B11);
+			E(S6) = EB(B22) - E(S5);
+			E(S8) = E(S6) - EB(B21);
+
+			/* S3 = A11 - A21 */
+			E(S3) = EA(A11) - EA(A21);
+
+			/* S7 = B22 - B12 */
+			E(S7) = EB(B22) - EB(B12);
+
+			TempMatrixOffset += sizeof(REAL);
+			MatrixOffsetA += sizeof(REAL);
+			MatrixOffsetB += sizeof(REAL);
+		} /* end row loop*/
+
+		MatrixOffsetA += RowIncrementA;
+		MatrixOffsetB += RowIncrementB;
+	} /* end column loop */
+
+	std::vector<inncabs::dataflow::future<void>> futures;
+
+	/* M2 = A11 x B11 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, M2, A11, B11, QuadrantSize, QuadrantSize, RowWidthA, RowWidthB, Depth+1));
+
+	/* M5 = S1 * S5 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, M5, S1, S5, QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
+
+	/* Step 1 of T1 = S2 x S6 + M2 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, T1sMULT, S2, S6,  QuadrantSize, QuadrantSize, QuadrantSize, QuadrantSize, Depth+1));
+
+	/* Step 1 of T2 = T1 + S3 x S7 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, C22, S3, S7, QuadrantSize, RowWidthC /*FIXME*/, QuadrantSize, QuadrantSize, Depth+1));
+
+	/* Step 1 of C11 = M2 + A12 * B21 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, C11, A12, B21, QuadrantSize, RowWidthC, RowWidthA, RowWidthB, Depth+1));
+
+	/* Step 1 of C12 = S4 x B22 + T1 + M5 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, C12, S4, B22, QuadrantSize, RowWidthC, QuadrantSize, RowWidthB, Depth+1));
+
+	/* Step 1 of C21 = T2 - A22 * S8 */
+	futures.push_back(inncabs::dataflow::async(l, OptimizedStrassenMultiply_dataflow, l, C21, A22, S8, QuadrantSize, RowWidthC, RowWidthA, QuadrantSize, Depth+1));
+
+	/**********************************************
+	** Continuation: combines the products once all of them are ready
+	**********************************************/
+	return inncabs::dataflow::when_all(futures).then([=](inncabs::dataflow::future<void>) mutable {
+
+		/***************************************************************************
+		** Step through all columns row by row (vertically)
+		** (jumps in memory by RowWidth => bad locality)
+		** (but we want the best locality on the innermost loop)
+		***************************************************************************/
+		for(unsigned Row = 0; Row < QuadrantSize; Row++) {
+			/*************************************************************************
+			** Step through each row horizontally (addressing elements in each column)
+			** (jumps linearly througn memory => good locality)
+			*************************************************************************/
+			for(unsigned Column = 0; Column < QuadrantSize; Column += 4) {
+				REAL LocalM5_0 = *(M5);
+				REAL LocalM5_1 = *(M5+1);
+				REAL LocalM5_2 = *(M5+2);
+				REAL LocalM5_3 = *(M5+3);
+				REAL LocalM2_0 = *(M2);
+				REAL LocalM2_1 = *(M2+1);
+				REAL LocalM2_2 = *(M2+2);
+				REAL LocalM2_3 = *(M2+3);
+				REAL T1_0 = *(T1sMULT) + LocalM2_0;
+				REAL T1_1 = *(T1sMULT+1) + LocalM2_1;
+				REAL T1_2 = *(T1sMULT+2) + LocalM2_2;
+				REAL T1_3 = *(T1sMULT+3) + LocalM2_3;
+				REAL T2_0 = *(C22) + T1_0;
+				REAL T2_1 = *(C22+1) + T1_1;
+				REAL T2_2 = *(C22+2) + T1_2;
+				REAL T2_3 = *(C22+3) + T1_3;
+				(*(C11))   += LocalM2_0;
+				(*(C11+1)) += LocalM2_1;
+				(*(C11+2)) += LocalM2_2;
+				(*(C11+3)) += LocalM2_3;
+				(*(C12))   += LocalM5_0 + T1_0;
+				(*(C12+1)) += LocalM5_1 + T1_1;
+				(*(C12+2)) += LocalM5_2 + T1_2;
+				(*(C12+3)) += LocalM5_3 + T1_3;
+				(*(C22))   = LocalM5_0 + T2_0;
+				(*(C22+1)) = LocalM5_1 + T2_1;
+				(*(C22+2)) = LocalM5_2 + T2_2;
+				(*(C22+3)) = LocalM5_3 + T2_3;
+				(*(C21  )) = (- *(C21  )) + T2_0;
+				(*(C21+1)) = (- *(C21+1)) + T2_1;
+				(*(C21+2)) = (- *(C21+2)) + T2_2;
+				(*(C21+3)) = (- *(C21+3)) + T2_3;
+				M5 += 4;
+				M2 += 4;
+				T1sMULT += 4;
+				C11 += 4;
+				C12 += 4;
+				C21 += 4;
+				C22 += 4;
+			}
+			C11 = ( (C11 ) + RowIncrementC/sizeof(REAL));
+			C12 = ( (C12 ) + RowIncrementC/sizeof(REAL));
+			C21 = ( (C21 ) + RowIncrementC/sizeof(REAL));
+			C22 = ( (C22 ) + RowIncrementC/sizeof(REAL));
+		}
+		free(StartHeap);
+	});
+}
+
 /*
 * Set an n by n matrix A to random values. 
 */
@@ -868,8 +1082,15 @@ bool compare_matrix(int n, REAL *A, int an, REAL *B, int bn) {
 }
 
 /*
-* Allocate a matrix of side n (therefore n^2 elements)
+* Allocate a matrix of side n (therefore n^2 elements), placed according to INNCABS_NUMA
 */
 REAL *alloc_matrix(int n) {
-	return (REAL*)malloc(n * n * sizeof(REAL));
+	return inncabs::numa::alloc_array<REAL>((size_t)n * n);
+}
+
+/*
+* Release a matrix of side n allocated with alloc_matrix
+*/
+void free_matrix(int n, REAL *A) {
+	inncabs::numa::free(A, (size_t)n * n * sizeof(REAL));
 }
@@ -12,7 +12,7 @@
 
 #include "uts.h"
 
-int main(int argc, char** argv) {
+INNCABS_MAIN(uts) {
 	Node root;
 	const char *fn = argc > 1 ? argv[1] : "input/uts/test.input";
 	uts_read_file(fn);
@@ -20,8 +20,17 @@ int main(int argc, char** argv) {
 	std::stringstream ss;
 	ss << "Unbalanced Tree Search (" << fn << ")";
 	
+#ifdef INNCABS_COROUTINES
+	inncabs::coro::declare_variant();
+#endif
 	inncabs::run_all(
 		[&](const std::launch l) {
+#ifdef INNCABS_COROUTINES
+			if(l == inncabs::launch::coroutine) {
+				number_of_tasks = parallel_uts_coro(&root);
+				return number_of_tasks;
+			}
+#endif
 			number_of_tasks = parallel_uts(l, &root);
 			return number_of_tasks;
 		},
@@ -106,6 +106,10 @@ extern int    verbose;
 #define min(a,b) (((a) < (b)) ? (a) : (b))
 
 unsigned long long parTreeSearch(const std::launch l, int depth, Node *parent, int numChildren);
+#ifdef INNCABS_COROUTINES
+unsigned long long parallel_uts_coro(Node *root);
+inncabs::coro::task<unsigned long long> parTreeSearch_coro(int depth, Node *parent, int numChildren);
+#endif
 
 int    uts_paramsToStr(char *strBuf, int ind);
 void   uts_read_file(const char *file);
@@ -237,7 +241,7 @@ unsigned long long parTreeSearch(const std::launch l, int depth, Node *parent, i
 	n = (Node*)alloca(sizeof(Node)*numChildren);
 	Node *nodePtr;
 	unsigned long long subtreesize = 1;
-	std::vector<std::future<unsigned long long>> futures;
+	std::vector<inncabs::future<unsigned long long>> futures;
 
 	// Recurse on the children
 	for(int i = 0; i < numChildren; i++) {
@@ -252,7 +256,7 @@ unsigned long long parTreeSearch(const std::launch l, int depth, Node *parent, i
 
 		nodePtr->numChildren = uts_numChildren(nodePtr);
 
-		futures.push_back( std::async(l, parTreeSearch, l, depth+1, nodePtr, nodePtr->numChildren) );	
+		futures.push_back( inncabs::async(l, parTreeSearch, l, depth+1, nodePtr, nodePtr->numChildren) );	
 	}
 
 	for(auto& f: futures) {
@@ -262,6 +266,43 @@ unsigned long long parTreeSearch(const std::launch l, int depth, Node *parent, i
 	return subtreesize;
 }
 
+#ifdef INNCABS_COROUTINES
+unsigned long long parallel_uts_coro(Node *root) {
+	root->numChildren = uts_numChildren(root);
+	return inncabs::coro::run(parTreeSearch_coro(0, root, root->numChildren));
+}
+
+// coroutine variant of parTreeSearch, the children live in the coroutine frame instead of on the stack
+inncabs::coro::task<unsigned long long> parTreeSearch_coro(int depth, Node *parent, int numChildren) {
+	std::vector<Node> n(numChildren);
+	unsigned long long subtreesize = 1;
+	std::vector<inncabs::coro::task<unsigned long long>> tasks;
+	tasks.reserve(numChildren);
+
+	// Recurse on the children
+	for(int i = 0; i < numChildren; i++) {
+		Node *nodePtr = &n[i];
+
+		nodePtr->height = parent->height + 1;
+
+		// The following line is the work (one or more SHA-1 ops)
+		for(int j = 0; j < computeGranularity; j++) {
+			rng_spawn(parent->state.state, nodePtr->state.state, i);
+		}
+
+		nodePtr->numChildren = uts_numChildren(nodePtr);
+
+		tasks.push_back(inncabs::coro::spawn(parTreeSearch_coro(depth+1, nodePtr, nodePtr->numChildren)));
+	}
+
+	for(auto& t : tasks) {
+		subtreesize += co_await t;
+	}
+
+	co_return subtreesize;
+}
+#endif
+
 void uts_read_file(const char *filename) {
 	FILE *fin = fopen(filename, "r");
 